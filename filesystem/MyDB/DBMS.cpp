@@ -4,6 +4,39 @@ FileManager* DBMS::fm = FileManager::Instance();
 BufPageManager* DBMS::bpm = BufPageManager::Instance();
 
 
+void DBMS::ShowBufferStatus(){
+    BufStats perFile[MAX_FILE_NUM];
+    BufStats total = bpm->getStats(perFile);
+    std::vector<std::vector<std::string>> table;
+    table.push_back({"File", "Resident", "Dirty", "Hits", "Misses", "Hit ratio", "Mapped", "Evictions",
+        "Dirty evictions", "Write-backs", "Prefetches", "Read KB", "Write KB", "I/O errors", "Corrupt"});
+    auto addRow = [&table](const std::string& name, const BufStats& st){
+        char ratio[16];
+        sprintf(ratio, "%.2f%%", st.hitRatio() * 100);
+        table.push_back({name, std::to_string(st.resident), std::to_string(st.dirtyPages),
+            std::to_string(st.hits), std::to_string(st.misses), ratio, std::to_string(st.mappedReads), std::to_string(st.evictions),
+            std::to_string(st.dirtyEvictions), std::to_string(st.writeBacks), std::to_string(st.prefetches),
+            std::to_string(st.readBytes >> 10), std::to_string(st.writeBytes >> 10), std::to_string(st.ioErrors), std::to_string(st.corruptPages)});
+    };
+    // fileID会被复用，只列出有过访问或者仍有页面在缓存中的fileID
+    for(int i = 0; i < MAX_FILE_NUM; i++)
+        if(perFile[i].hits + perFile[i].misses + perFile[i].mappedReads + perFile[i].prefetches + perFile[i].ioErrors + perFile[i].resident > 0)
+            addRow(std::to_string(i), perFile[i]);
+    addRow("total", total);
+    printf("Buffer pool: %d frames (%d MB), %d shards%s%s%s, page checksums (crc32c%s, %llu corrupt pages)\n", bpm->capacity(),
+        (int)(((ll)bpm->capacity() << PAGE_SIZE_IDX) >> 20), BUF_SHARD_NUM, bpm->usingHugePages() ? ", huge pages" : "",
+        bpm->usingAsyncIO() ? ", io_uring" : "", fm->usingDirectIO() ? ", O_DIRECT" : "", crc32cHasHardware() ? " sse4.2" : "",
+        fm->corruptPages());
+    Printer::PrintTable(table, table[0].size(), table.size());
+    LogManager* log = currentDB ? currentDB->GetLog() : nullptr;
+    if(log != nullptr){
+        LogStats st = log->GetStats();
+        printf("Log: %llu commits (%.1f/s, %llu grouped), %llu fsyncs (%.1f/s), %llu checkpoints, %llu KB written, %llu KB to redo, commit delay %d us\n",
+            st.commits, st.commitsPerSecond(), st.groupedCommits, st.fsyncs, st.fsyncsPerSecond(), st.checkpoints,
+            st.writeBytes >> 10, log->Size() >> 10, log->CommitDelay());
+    }
+}
+
 
 int DataType::cmpLongVarchar(uint lpage, uint lslot, uint rpage, uint rslot){
     return DBMS::Instance()->CurrentDatabase()->CompareLongVarchar(lpage, lslot, rpage, rslot);
@@ -14,8 +47,8 @@ void DataType::LoadLongVarchar(uint page, uint slot, uchar* dst, ushort& len){
     DBMS::Instance()->CurrentDatabase()->GetLongVarchar(tmpRID, dst, len);
 }
 
-std::string Printer::FieldToStr(const Record& tmpRec, uchar type, uchar index, ushort length, uint offset){
-        if(getBitFromLeft(*(uint*)tmpRec.GetData(), index))
+std::string Printer::FieldToStr(const uchar* data, uchar type, uchar index, ushort length, uint offset){
+        if(getBitFromLeft(*(uint*)data, index))
             return "null";
         else
             switch (type)
@@ -23,8 +56,8 @@ std::string Printer::FieldToStr(const Record& tmpRec, uchar type, uchar index, u
             case DataType::NUMERIC:{
                 int p = length >> 8, s = length & 0xff;
                 uchar buf[p];
-                DataType::binToDigits(tmpRec.GetData() + offset + 1, buf, p);
-                uchar firstByte = tmpRec.GetData()[offset];
+                DataType::binToDigits(data + offset + 1, buf, p);
+                uchar firstByte = data[offset];
                 bool hasSign = firstByte & 128;
                 uchar dotPos = firstByte & 63;
                 string str;
@@ -57,27 +90,27 @@ std::string Printer::FieldToStr(const Record& tmpRec, uchar type, uchar index, u
             }
             case DataType::DATE:{
                 int y, m, d;
-                DataType::binToDate(tmpRec.GetData() + offset, y, m, d);
+                DataType::binToDate(data + offset, y, m, d);
                 return std::to_string(y) + "-" + std::to_string(m) + "-" + std::to_string(d);
             }
             case DataType::INT:{
-                return std::to_string(*(int*)(tmpRec.GetData() + offset));
+                return std::to_string(*(int*)(data + offset));
             }
             case DataType::BIGINT:{
-                return std::to_string(*(ll*)(tmpRec.GetData() + offset));
+                return std::to_string(*(ll*)(data + offset));
             }
             case DataType::FLOAT:{
-                return std::to_string(*(float*)(tmpRec.GetData() + offset));
+                return std::to_string(*(float*)(data + offset));
             }
             case DataType::CHAR:{
-                return string((char*)(tmpRec.GetData() + offset), strnlen((char*)(tmpRec.GetData() + offset), length));
+                return string((char*)(data + offset), strnlen((char*)(data + offset), length));
             }
             case DataType::VARCHAR:{
                 if(length <= 255)
-                    return string((char*)(tmpRec.GetData() + offset), strnlen((char*)(tmpRec.GetData() + offset), length));
+                    return string((char*)(data + offset), strnlen((char*)(data + offset), length));
                 else{
                     uchar buf[length] = {0};
-                    int page = *(uint*)(tmpRec.GetData() + offset), slot = *(uint*)(tmpRec.GetData() + offset + 4);
+                    int page = *(uint*)(data + offset), slot = *(uint*)(data + offset + 4);
                     ushort realLen = 0;
                     DBMS::Instance()->CurrentDatabase()->GetLongVarchar(RID(page, slot), buf, realLen);
                     return string((char*)buf, realLen);
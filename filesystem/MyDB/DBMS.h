@@ -42,6 +42,12 @@ class DBMS{
             currentDB = nullptr;
         }
 
+        // ALL_DB不写日志, 修改后立即写回, 崩溃后数据库列表和目录保持一致
+        void syncDatabaseList(){
+            if(!bpm->flushFile(tb->fid))
+                printf("In DBMS, cannot write back database list\n");
+        }
+
         // 新建目录
         bool createDir(const char* dirName){
             return mkdir(dirName, S_IRWXU | S_IRWXG | S_IRWXO) == 0;
@@ -102,6 +108,8 @@ class DBMS{
             scanner = tb->GetScanner(nullptr);
             rec = new Record();
             rid = new RID();
+            bpm->startFlusher();
+            bpm->startPrefetcher();
             return true;
         }
         
@@ -116,22 +124,27 @@ class DBMS{
             memcpy(buf + 4, databaseName, strnlen(databaseName, MAX_DB_NAME_LEN));
             createDir(databaseName);
             tb->InsertRecord(buf, rid);
+            syncDatabaseList();
             return true;
         }
 
         // 使用数据库
         // 非法名字长度（0或>MAX_DB_NAME_LEN）由frontend检查
+        // readOnly为true时只读打开, 表文件被映射到内存中, 修改数据库的语句由frontend拒绝
+        // 已经以另一种方式打开时关闭后重新打开
         // 不存在时返回nullptr
-        Database* UseDatabase(const char* databaseName){
+        Database* UseDatabase(const char* databaseName, bool readOnly = false){
             if(databaseExists(databaseName)){
                 if(currentDB){ // there is an open database
-                    if(!identical(databaseName, DBMS_RESERVED_TABLE_NAME, MAX_DB_NAME_LEN)) // switch to another database
+                    if(!identical(databaseName, currentDB->GetName(), MAX_DB_NAME_LEN)) // switch to another database
+                        closeCurrentDatabase();
+                    else if(currentDB->IsReadOnly() != readOnly) // reopen in the requested mode
                         closeCurrentDatabase();
                     else // target database already opened
                         return currentDB;
                 }
                 // no db is open or the opened db is not the target
-                currentDB = new Database(databaseName);
+                currentDB = new Database(databaseName, readOnly);
                 // TODO ???
                 return currentDB;
             }
@@ -147,6 +160,7 @@ class DBMS{
                 if(currentDB && identical(databaseName, DBMS_RESERVED_TABLE_NAME, MAX_DB_NAME_LEN)) // 要被删除的数据库已经打开
                     closeCurrentDatabase();
                 tb->DeleteRecord(*rec->GetRid()); // 如果databaseExists返回true，对应记录的RID和数据会被存到rec里
+                syncDatabaseList();
                 // delete file and folder
                 int db_info_fid;
                 char buf[MAX_DB_NAME_LEN + 1 + MAX_TABLE_NAME_LEN] = "";
@@ -156,22 +170,24 @@ class DBMS{
                     removeDir(databaseName);
                 else{
                     Table* tmpTable = new Table(db_info_fid, buf, nullptr);
-                    Scanner *tables = tmpTable->GetScanner([](const Record& record)->bool{return true;});
+                    Scanner *tables = tmpTable->GetScanner([](const RecordView& record)->bool{return true;});
                     Record tmpRec;
                     while(tables->NextRecord(&tmpRec)){
                         snprintf(buf + strlen(databaseName) + 1, MAX_TABLE_NAME_LEN ,"%s", tmpRec.GetData());
-                        remove(buf);
+                        PageChecksums::remove(buf);
                         tmpRec.FreeMemory();
                     }
                     tmpTable->WriteBack();
                     delete tmpTable;
                     // remove DB level reserved tables
                     sprintf(buf + strlen(databaseName) + 1, "%s", DB_RESERVED_TABLE_NAME);
-                    remove(buf);
+                    PageChecksums::remove(buf);
                     sprintf(buf + strlen(databaseName) + 1, "%s", VARCHAR_RESERVED_TABLE_NAME);
-                    remove(buf);
+                    PageChecksums::remove(buf);
                     sprintf(buf + strlen(databaseName) + 1, "%s", IDX_RESERVED_TABLE_NAME);
-                    remove(buf);
+                    PageChecksums::remove(buf);
+                    sprintf(buf + strlen(databaseName) + 1, "%s", LOG_RESERVED_NAME);
+                    PageChecksums::remove(buf);
                     removeDir(databaseName);
                 }
                 return true;
@@ -185,10 +201,16 @@ class DBMS{
          * 返回可以遍历ALL_DB表的scanner
         */
         Scanner* ShowDatabases(){
-            scanner->SetDemand([](const Record& rec)->bool{return true;});
+            scanner->SetDemand([](const RecordView& rec)->bool{return true;});
             return scanner;
         }
 
+        /**
+         * show buffer status命令
+         * 打印缓存的总体统计和每个fileID的统计
+        */
+        void ShowBufferStatus();
+
         Database* CurrentDatabase(){
             return currentDB;
         }
@@ -209,6 +231,11 @@ class DBMS{
                 delete rec;
             if(rid)
                 delete rid;
+            // 后台线程停止后,把剩下的脏页全部写回
+            bpm->stopPrefetcher();
+            bpm->stopFlusher();
+            if(!bpm->close())
+                printf("In DBMS::Close, some pages cannot be written back\n");
         }
 };
 #endif
\ No newline at end of file
@@ -4,11 +4,44 @@ BufPageManager* Database::bpm = BufPageManager::Instance();
 FileManager* Database::fm = FileManager::Instance();
 std::vector<Table*> Database::activeTables;
 
+void Database::ShowTableStatus(){
+    // OpenTable会用到infoScanner, 先取出所有表名
+    std::vector<std::string> names;
+    Scanner* scanner = ShowTables();
+    RecordView view;
+    while(scanner->NextView(&view)){
+        names.push_back(std::string((const char*)view.GetData() + 4, strnlen((const char*)view.GetData() + 4, MAX_TABLE_NAME_LEN)));
+    }
+    scanner->Reset();
+    std::vector<std::vector<std::string>> table;
+    table.push_back({"Table", "Format", "Compression", "Pages", "Size KB", "On disk KB", "Saved"});
+    ull totalLogical = 0, totalPhysical = 0;
+    auto addRow = [&table](const std::string& name, const char* format, const char* compression, ull logical, ull physical){
+        char saved[16];
+        sprintf(saved, "%.1f%%", logical > physical ? (double)(logical - physical) * 100 / logical : 0.0);
+        table.push_back({name, format, compression, std::to_string(logical >> PAGE_SIZE_IDX), std::to_string(logical >> 10),
+            std::to_string(physical >> 10), saved});
+    };
+    for(auto it = names.begin(); it != names.end(); it++){
+        ull logical = 0, physical = 0;
+        FileManager::diskUsage(getPath(it->data()), logical, physical);
+        Table* t = OpenTable(it->data());
+        bool compressed = t != nullptr && t->IsCompressed(), slotted = t != nullptr && t->IsSlotted();
+        if(t != nullptr)
+            CloseTable(it->data());
+        addRow(*it, slotted ? "slotted" : "fixed", compressed ? "lz4" : "none", logical, physical);
+        totalLogical += logical;
+        totalPhysical += physical;
+    }
+    addRow("total", "", "", totalLogical, totalPhysical);
+    Printer::PrintTable(table, table[0].size(), table.size());
+}
+
 // table ops
 int Table::CreateIndexOn(std::vector<uchar> cols, const char* idxName){
     if(idxCount == MAX_INDEX_NUM) // full
         return 2;
-    headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
+    pinHeader();
     for(int i = 0; i < idxCount; i++)
         if(identical(idxName, (char*)header->indexName[i], MAX_INDEX_NAME_LEN)) // conflict
             return 1;
@@ -31,13 +64,13 @@ int Table::CreateIndexOn(std::vector<uchar> cols, const char* idxName){
     BplusTree* tree = new BplusTree(db->idx, idxHeader);
     header->bpTreePage[idxCount] = tree->TreeHeaderPage();
     // TODO add existing record into index
-    Scanner* scanner = GetScanner([](const Record& rec)->bool{return true;});
-    Record tmpRec;
+    BulkAccess bulk(bpm, fid); // 全表扫描不挤占共享缓存
+    Scanner* scanner = GetScanner([](const RecordView& rec)->bool{return true;});
+    RecordView view;
     uchar idxBuf[tree->header->recordLenth] = {0};
-    while(scanner->NextRecord(&tmpRec)){
-        BplusTree::getIndexFromRecord(tree->header, this, tmpRec.GetData(), idxBuf);
-        tree->SafeInsert(idxBuf, *tmpRec.GetRid());
-        tmpRec.FreeMemory();
+    while(scanner->NextView(&view)){
+        BplusTree::getIndexFromRecord(tree->header, this, view.GetData(), idxBuf);
+        tree->SafeInsert(idxBuf, *view.GetRid());
     }
     delete scanner;
     delete tree;
@@ -89,18 +122,38 @@ bool Table::BatchLoad(const char* filename, char delim){
         trees.push_back(new BplusTree(db->idx, header->primaryIndexPage));
     for(int i = 0; i < idxCount; i++)
         trees.push_back(new BplusTree(db->idx, header->bpTreePage[i]));
+    // 新写入的数据页只经过环形缓冲区，索引页仍使用共享缓存
+    BulkAccess bulk(bpm, fid);
+    // 攒够一页的记录再用InsertRecords一起插入，之后逐条更新索引
+    int batchCap = header->slotNum, batchSize = 0;
+    std::vector<uchar> batch((size_t)batchCap * header->recordLenth);
+    std::vector<RID> rids(batchCap);
+    bool full = false;
+    auto flush = [&](){
+        int inserted = InsertRecords(batch.data(), batchSize, rids.data());
+        if(inserted < batchSize)
+            full = true;
+        for(int k = 0; k < inserted; k++){
+            const uchar* rec = batch.data() + (size_t)k * header->recordLenth;
+            for(int i = 0; i < trees.size(); i++){
+                uchar idxBuf[trees[i]->header->recordLenth]{0};
+                BplusTree::getIndexFromRecord(trees[i]->header, this, rec, idxBuf);
+                trees[i]->SafeInsert(idxBuf, rids[k]);
+            }
+        }
+        batchSize = 0;
+    };
     while(true){
         c = fin.get();
         if(c == EOF)
             break;
         if(c == '\n'){
             assert(recField == colCount);
-            RID rid;
-            InsertRecord(recBuf, &rid);
-            for(int i = 0; i < trees.size(); i++){
-                uchar idxBuf[trees[i]->header->recordLenth]{0};
-                BplusTree::getIndexFromRecord(trees[i]->header, this, recBuf, idxBuf);
-                trees[i]->SafeInsert(idxBuf, rid);
+            memcpy(batch.data() + (size_t)batchSize * header->recordLenth, recBuf, header->recordLenth);
+            if(++batchSize == batchCap){
+                flush();
+                if(full)
+                    break;
             }
             memset(lineBuf, 0, iter);
             memset(recBuf, 0, sizeof(recBuf));
@@ -122,6 +175,7 @@ bool Table::BatchLoad(const char* filename, char delim){
         else
             lineBuf[iter++] = c;
     }
+    flush();
     fin.close();
     for(auto it = trees.begin(); it != trees.end(); it++)
         delete *it;
@@ -155,16 +209,16 @@ bool Table::CreatePrimaryIndex(){
     memcpy(idxHeader->tableName, tablename, MAX_TABLE_NAME_LEN);
     BplusTree* tree = new BplusTree(db->idx, idxHeader);
     // TODO: 检查重复
-    Scanner* scanner = GetScanner([](const Record& rec)->bool{return true;});
-    Record tmpRec;
+    BulkAccess bulk(bpm, fid); // 全表扫描不挤占共享缓存
+    Scanner* scanner = GetScanner([](const RecordView& rec)->bool{return true;});
+    RecordView view;
     uchar buf[tree->header->recordLenth] = {0};
     bool ok = true;
-    while(ok && scanner->NextRecord(&tmpRec)){
+    while(ok && scanner->NextView(&view)){
         memset(buf, 0, sizeof(buf));
-        BplusTree::getIndexFromRecord(tree->header, this, tmpRec.GetData(), buf);
-        if(!tree->SafeInsert(buf, *tmpRec.GetRid()))
+        BplusTree::getIndexFromRecord(tree->header, this, view.GetData(), buf);
+        if(!tree->SafeInsert(buf, *view.GetRid()))
             ok = false;
-        tmpRec.FreeMemory();
     }
     delete scanner;
     if(ok)
@@ -188,17 +242,16 @@ int Table::AddFKMaster(uchar masterID, std::vector<uchar> slaveKeys, const char*
             return 1; // existing fk with the same name
     }
     // check record conflicts
-    Scanner* scanner = GetScanner([](const Record&)->bool{return true;});
-    Record tmpRec;
+    Scanner* scanner = GetScanner([](const RecordView&)->bool{return true;});
+    RecordView view;
     BplusTree* tree = new BplusTree(db->idx, master->header->primaryIndexPage);
     uchar buf[tree->header->recordLenth] = {0};
     bool ok = true;
-    while(ok && scanner->NextRecord(&tmpRec)){
+    while(ok && scanner->NextView(&view)){
         memset(buf, 0, sizeof(buf));
-        extractFields(this, tmpRec.GetData(), buf, slaveKeys);
+        extractFields(this, view.GetData(), buf, slaveKeys);
         if(!tree->RecExists(buf))
             ok = false;
-        tmpRec.FreeMemory();
     }
     delete scanner;
     delete tree;
@@ -237,7 +290,7 @@ void Table::Print(){
         tmp.push_back(DataType::TypeToString(header->attrType[i], header->attrLenth[i]));
         tmp.push_back(getBitFromLeft(header->nullMask, i) ? "" : "not null");
         if(getBitFromLeft(header->defaultKeyMask, i)){
-            tmp.push_back(Printer::FieldToStr(tmpRec, header->attrType[i], i, header->attrLenth[i], offsets[i]));
+            tmp.push_back(Printer::FieldToStr(tmpRec.GetData(), header->attrType[i], i, header->attrLenth[i], offsets[i]));
         }
         else
             tmp.push_back(""); // no default value
@@ -8,9 +8,14 @@
 #include "Scanner.h"
 #include <vector>
 #include "../indexing/BplusTree.h"
+#include "../log/LogManager.h"
 
 class Database{
     char name[MAX_DB_NAME_LEN] = "";
+    // 只读打开的数据库, 文件被映射到内存中, 不能修改
+    bool readOnly = false;
+    // 预写日志, 只读打开时为nullptr
+    LogManager* log = nullptr;
 
     static BufPageManager* bpm;
     static FileManager* fm;
@@ -28,8 +33,9 @@ class Database{
     }
 
     void closeAndRemoveTableAt(int index){
-        activeTables[index]->WriteBack();
-        int closeret = fm->closeFile(activeTables[index]->fid);
+        if(!activeTables[index]->WriteBack())
+            printf("In Database::CloseTable, cannot write back table\n");
+        int closeret = closeFile(activeTables[index]->fid);
         delete activeTables[index]; // free memory
         activeTables.erase(activeTables.begin() + index);
         if(closeret != 0)
@@ -41,8 +47,7 @@ class Database{
     // }
 
     void resetBufInTable(int index){
-        activeTables[index]->tmpBuf = nullptr;
-        activeTables[index]->headerBuf = nullptr;
+        activeTables[index]->releaseGuards();
     }
 
     // void resetAllBuf(){
@@ -54,7 +59,8 @@ class Database{
     bool tablenameReserved(const char* tableName){
         return identical(tableName, DB_RESERVED_TABLE_NAME, MAX_TABLE_NAME_LEN) ||
             identical(tableName, IDX_RESERVED_TABLE_NAME, MAX_TABLE_NAME_LEN) ||
-            identical(tableName, VARCHAR_RESERVED_TABLE_NAME, MAX_TABLE_NAME_LEN);
+            identical(tableName, VARCHAR_RESERVED_TABLE_NAME, MAX_TABLE_NAME_LEN) ||
+            identical(tableName, LOG_RESERVED_NAME, MAX_TABLE_NAME_LEN);
     }
 
     char filePathBuf[MAX_DB_NAME_LEN + MAX_TABLE_NAME_LEN + 3 + 4 + 1] = ""; // 3 = ./***/***, 4 = ***-TMP, 1 = \0
@@ -68,6 +74,79 @@ class Database{
         return std::string(name ,strnlen(name, MAX_TABLE_NAME_LEN)) + "/" + std::string(tableName);
     }
 
+    // 读写打开时把文件登记到日志中, 之后对它的修改都写日志
+    void attach(int fid, const char* tableName){
+        if(log != nullptr)
+            log->Attach(fid, getPath(tableName));
+    }
+
+    // 关闭文件, 文件的页面需要已经由Table::WriteBack写回
+    int closeFile(int fid){
+        if(log != nullptr)
+            log->Detach(fid);
+        return fm->closeFile(fid);
+    }
+
+    // 新文件的页面也经过缓存写入, 解除钉住时写日志, 写回之前日志先落盘, 否则崩溃后文件可能是空的, 而ALL_TB中已经有这个表
+    // 文件需要已经attach, 在组中时组结束之后才能写回
+    bool writeNewPage(int fid, int pageID, const uchar* buf){
+        int index;
+        uchar* page = bpm->pinPage(fid, pageID, index);
+        if(page == nullptr)
+            return false;
+        memcpy(page, buf, PAGE_SIZE);
+        bpm->markDirty(index);
+        bpm->unpin(index);
+        return true;
+    }
+
+    /**
+     * 打开日志并重做上次没有正常关闭时留下的修改, 之后清空日志
+     * 恢复失败时日志保留到下一次打开, 这次不写日志
+    */
+    void openLog(){
+        log = new LogManager();
+        bool ok = log->Open(getPath(LOG_RESERVED_NAME));
+        if(ok){
+            int groups = log->Recover();
+            if(groups > 0)
+                printf("Recovered %d groups of changes from the log\n", groups);
+            ok = groups >= 0 && log->Truncate();
+        }
+        if(!ok || readOnly){
+            if(!ok)
+                printf("In Database::Database, cannot recover from the log, changes will not be logged\n");
+            delete log;
+            log = nullptr;
+            return;
+        }
+        bpm->setLog(log);
+    }
+
+    /**
+     * 完全检查点: 写回所有脏页, 落盘后清空日志. 用于改名和删除表之后, 平时的检查点不需要写回所有脏页
+     * 不能在LogGroup中调用
+    */
+    bool checkpoint(){
+        if(log == nullptr)
+            return true;
+        if(!bpm->flushAll()){
+            printf("In Database::checkpoint, cannot write back dirty pages\n");
+            return false;
+        }
+        return log->Truncate();
+    }
+
+    // 只读打开时, 刚刚初始化的预留表是以读写方式打开的, 写完后重新只读打开
+    void reopenReadOnly(const char* tableName, int& fid){
+        if(!bpm->flushFile(fid))
+            printf("In Database::Database, cannot write back file\n");
+        if(closeFile(fid) != 0)
+            printf("In Database::Database, cannot close file\n");
+        if(!fm->openFile(getPath(tableName), fid, true))
+            printf("In Database::Database, cannot reopen file read-only\n");
+    }
+
     // 存储所有用户表
     Table *info = nullptr;
     Scanner* infoScanner = nullptr;
@@ -80,17 +159,30 @@ class Database{
         // 存储索引节点
         Table *idx = nullptr;
 
-        Database(const char* databaseName){
+        /**
+         * readOnly为true时只读打开, 所有表文件都被映射到内存中, 页面不经过缓存
+        */
+        Database(const char* databaseName, bool readOnly = false){
             memcpy(name, databaseName, strnlen(databaseName, MAX_DB_NAME_LEN));
+            this->readOnly = readOnly;
+            // 先重做日志, 表文件打开时已经包含上次提交的所有修改
+            openLog();
             int fid_info, fid_idx, fid_varchar;
-            bool openret_info = fm->openFile(getPath(DB_RESERVED_TABLE_NAME), fid_info),
-                openret_idx = fm->openFile(getPath(IDX_RESERVED_TABLE_NAME), fid_idx),
-                openret_varchar = fm->openFile(getPath(VARCHAR_RESERVED_TABLE_NAME), fid_varchar);
+            bool openret_info = fm->openFile(getPath(DB_RESERVED_TABLE_NAME), fid_info, readOnly),
+                openret_idx = fm->openFile(getPath(IDX_RESERVED_TABLE_NAME), fid_idx, readOnly),
+                openret_varchar = fm->openFile(getPath(VARCHAR_RESERVED_TABLE_NAME), fid_varchar, readOnly);
+            if(openret_info)
+                attach(fid_info, DB_RESERVED_TABLE_NAME);
+            if(openret_idx)
+                attach(fid_idx, IDX_RESERVED_TABLE_NAME);
+            if(openret_varchar)
+                attach(fid_varchar, VARCHAR_RESERVED_TABLE_NAME);
             if(!openret_info){
                 printf("Initializing db info\n");
                 // create info
                 fm->createFile(getPath(DB_RESERVED_TABLE_NAME));
                 fm->openFile(getPath(DB_RESERVED_TABLE_NAME), fid_info);
+                attach(fid_info, DB_RESERVED_TABLE_NAME);
                 uchar* buffer = new uchar[PAGE_SIZE]{};
                 Header* header = new Header();
                 header->recordLenth = MAX_TABLE_NAME_LEN + 4; // ? null word
@@ -104,15 +196,18 @@ class Database{
                 header->exploitedNum = 1;
                 header->ToString(buffer);
                 delete header;
-                fm->writePage(fid_info, 0, (BufType)buffer, 0);
+                writeNewPage(fid_info, 0, buffer);
                 delete[] buffer;
                 printf("db info init success\n");
+                if(readOnly)
+                    reopenReadOnly(DB_RESERVED_TABLE_NAME, fid_info);
             }
             if(!openret_idx){
                 printf("Initializing db index\n");
                 // create info
                 fm->createFile(getPath(IDX_RESERVED_TABLE_NAME));
                 fm->openFile(getPath(IDX_RESERVED_TABLE_NAME), fid_idx);
+                attach(fid_idx, IDX_RESERVED_TABLE_NAME);
                 uchar* buffer = new uchar[PAGE_SIZE]{};
                 Header* header = new Header();
                 header->recordLenth = PAGE_SIZE; // ? B+ tree pages are never compared as a whole record, so it will be ok to ignore the null word thing?
@@ -124,15 +219,18 @@ class Database{
                 header->exploitedNum = 1;
                 header->ToString(buffer);
                 delete header;
-                fm->writePage(fid_idx, 0, (BufType)buffer, 0);
+                writeNewPage(fid_idx, 0, buffer);
                 delete[] buffer;
                 printf("db index init success\n");
+                if(readOnly)
+                    reopenReadOnly(IDX_RESERVED_TABLE_NAME, fid_idx);
             }
             if(!openret_varchar){
                 printf("Initializing db varchar\n");
                 // create info
                 fm->createFile(getPath(VARCHAR_RESERVED_TABLE_NAME));
                 fm->openFile(getPath(VARCHAR_RESERVED_TABLE_NAME), fid_varchar);
+                attach(fid_varchar, VARCHAR_RESERVED_TABLE_NAME);
                 uchar* buffer = new uchar[PAGE_SIZE]{};
                 Header* header = new Header();
                 header->recordLenth = VARCHAR_RECORD_LEN;;
@@ -157,9 +255,11 @@ class Database{
                 header->exploitedNum = 1;
                 header->ToString(buffer);
                 delete header;
-                fm->writePage(fid_varchar, 0, (BufType)buffer, 0);
+                writeNewPage(fid_varchar, 0, buffer);
                 delete[] buffer;
                 printf("db varchar init success\n");
+                if(readOnly)
+                    reopenReadOnly(VARCHAR_RESERVED_TABLE_NAME, fid_varchar);
             }
             // load info from disk
             info = new Table(fid_info, DB_RESERVED_TABLE_NAME, this);
@@ -207,29 +307,45 @@ class Database{
             buffer[header->GetLenth()] = 128; // manually set the first bit in bitmap to 1
             header->recordNum = 1;
             header->exploitedNum = 1;
+            {
+                // 新文件的页面和ALL_TB中的记录在同一组日志中
+                LogGroup group(bpm);
+                attach(fid, tablename);
+                if(header->defaultKeyMask || (header->options & Header::Slotted)){ // insert the default record. Note that even there is no default record, page 1 is still seen as occupied
+                    uchar* defaultBuf = new uchar[PAGE_SIZE]{};
+                    if(header->options & Header::Slotted){ // 变长记录的表中模板记录总要放进第0个槽位, 否则插入时会占用它
+                        int colNum = 0;
+                        while(colNum < MAX_COL_NUM && header->attrType[colNum] != DataType::NONE)
+                            colNum++;
+                        std::vector<uchar> row(header->recordLenth, 0), tuple(SlottedPage::MaxLen(header->attrType, header->attrLenth, colNum));
+                        if(header->defaultKeyMask)
+                            memcpy(row.data(), defaultRecord, header->recordLenth);
+                        int len = SlottedPage::Encode(header->attrType, header->attrLenth, colNum, row.data(), tuple.data());
+                        SlottedPage::Init(defaultBuf);
+                        memcpy(SlottedPage::Alloc(defaultBuf, 0, len, 0), tuple.data(), len);
+                    }
+                    else
+                        memcpy(defaultBuf, defaultRecord, header->recordLenth);
+                    if(!writeNewPage(fid, START_PAGE, defaultBuf))
+                        printf("In Database::CreateTable, cannot write default record\n");
+                    delete[] defaultBuf;
+                }
 
-            if(header->defaultKeyMask){ // insert the default record. Note that even there is no default record, page 1 is still seen as occupied
-                uchar* defaultBuf = new uchar[PAGE_SIZE]{};
-                    memcpy(defaultBuf, defaultRecord, header->recordLenth);
-                int defaultret = fm->writePage(fid, START_PAGE, (BufType)defaultBuf, 0);
-                delete[] defaultBuf;
-                if(defaultret != 0)
-                    printf("In Database::CreateTable, cannot write default record\n");
-            }
-
-            header->ToString(buffer);
-            int writeret = fm->writePage(fid, 0, (BufType)buffer, 0);
-            delete[] buffer;
-            if(writeret != 0){
-                printf("In Database::CreateTable, cannot write header\n");
+                header->ToString(buffer);
+                if(!writeNewPage(fid, 0, buffer))
+                    printf("In Database::CreateTable, cannot write header\n");
+                delete[] buffer;
+                uchar data[MAX_TABLE_NAME_LEN + 4] = {0}; // ? null word
+                memcpy(data + 4, tablename, strlen(tablename));
+                info->InsertRecord(data, rid);
             }
-            int closeret = fm->closeFile(fid); // Even if file cannot be written, it still should be closed
+            // 组结束之后新文件的页面才能写回
+            if(!bpm->flushFile(fid))
+                printf("In Database::CreateTable, cannot write back file\n");
+            int closeret = closeFile(fid); // Even if file cannot be written, it still should be closed
             if(closeret != 0){
                 printf("In Databse::CreateTable, cannot close file\n");
             }
-            uchar data[MAX_TABLE_NAME_LEN + 4] = {0}; // ? null word
-            memcpy(data + 4, tablename, strlen(tablename));
-            info->InsertRecord(data, rid);
             return rid->GetSlotNum() - 1; // ? the same hazard as in OpenTable
         }
 
@@ -239,8 +355,17 @@ class Database{
         bool DeleteTable(const char* tablename){
             // TODO: protection for reserved tables? or in parser?
             if(TableExists(tablename)){
-                remove(getPath(tablename));
-                info->DeleteRecord(*rec->GetRid());
+                {
+                    LogGroup group(bpm);
+                    info->DeleteRecord(*rec->GetRid());
+                    if(log != nullptr)
+                        log->LogRemove(getPath(tablename));
+                }
+                // 日志落盘后再删除文件, 之后清空日志, 恢复时不会再遇到这个文件的修改
+                if(log != nullptr && !log->Flush())
+                    printf("In Database::DeleteTable, cannot flush the log\n");
+                PageChecksums::remove(getPath(tablename));
+                checkpoint();
                 return true;
             }
             return false;
@@ -259,11 +384,12 @@ class Database{
                     printf("WARNING: reopening table %s", tablename);
             }
             int fid;
-            bool openret = fm->openFile(getPath(tablename), fid);
+            bool openret = fm->openFile(getPath(tablename), fid, readOnly);
             if(!openret){
                 printf("In Database::OpenTable, cannot open file\n");
                 return nullptr;
             }
+            attach(fid, tablename);
             Table* ans = new Table(fid, tablename, this, rec->GetRid()->GetSlotNum() - 1); // ? This way of acquiring table ID may be ok if only page 1 is used in info
             activeTables.push_back(ans);
             return ans;
@@ -308,9 +434,19 @@ class Database{
             if(TableExists(oldName)){ // after calling tableExist(name), the found record is stored in 'rec'
                 memset(rec->GetData() + 4, 0, MAX_TABLE_NAME_LEN); // ? null word
                 memcpy(rec->GetData() + 4, newName, strlen(newName));
-                info->UpdateRecord(*rec->GetRid(), rec->GetData(), 0, 0, MAX_TABLE_NAME_LEN);
+                std::string oldPath = getPath(oldName), newPath = getPath(newName);
+                {
+                    LogGroup group(bpm);
+                    info->UpdateRecord(*rec->GetRid(), rec->GetData(), 0, 0, MAX_TABLE_NAME_LEN);
+                    if(log != nullptr)
+                        log->LogRename(oldPath.data(), newPath.data());
+                }
+                // 和DeleteTable一样, 日志落盘后再改名, 之后清空日志
+                if(log != nullptr && !log->Flush())
+                    printf("In Database::RenameTable, cannot flush the log\n");
                 // rename(getPath(oldName), getPath(newName)); // ! 这样写的话,第二个getPath回覆盖第一个getPath的结果
-                rename(strPath(oldName).data(), getPath(newName));
+                PageChecksums::rename(oldPath.data(), newPath.data());
+                checkpoint();
                 return true;
             }
             else
@@ -453,48 +589,92 @@ class Database{
         }
 
         Scanner* ShowTables(){
-            infoScanner->SetDemand([](const Record& record)->bool{return true;});
+            infoScanner->SetDemand([](const RecordView& record)->bool{return true;});
             return infoScanner;
         }
 
         /**
-         * 写回所有打开的表
+         * 列出每个表文件的大小和实际占用的磁盘空间, 压缩的表的页面打洞后占用的空间更少
+        */
+        void ShowTableStatus();
+
+        /**
+         * 写回所有打开的表, 在每条语句结束时调用
+         * 之后日志落盘, 语句的修改不会因为崩溃而丢失. 检查点由后台写回线程进行, 见BufPageManager::flushRound
         */
         void CloseTables(){
             for(auto it = activeTables.begin(); it != activeTables.end(); it++){
-                (*it)->WriteBack();
-                int closeRet = fm->closeFile((*it)->fid);
+                if(!(*it)->WriteBack())
+                    printf("In Database::CloseTables, cannot write back table\n");
+                int closeRet = closeFile((*it)->fid);
                 delete *it;
                 if(closeRet != 0)
                     printf("In Database::Close, error when closing table\n");
             }
             activeTables.clear();
+            if(log != nullptr){
+                // 预留表一直打开, 解除对它们的页面的钉住, 否则这些页面不能被后台线程写回, 检查点无法推进
+                info->releaseGuards();
+                idx->releaseGuards();
+                varchar->releaseGuards();
+                bpm->logPinned();
+                if(!log->Commit())
+                    printf("In Database::CloseTables, cannot flush the log\n");
+            }
         }
 
         /**
          * 关闭这个数据库
         */
         void Close(){
-            info->WriteBack();
-            idx->WriteBack();
-            varchar->WriteBack();
+            bool ok = info->WriteBack();
+            ok = idx->WriteBack() && ok;
+            ok = varchar->WriteBack() && ok;
+            if(!ok)
+                printf("In Database::Close, cannot write back reserved tables\n");
+            // 只读打开的文件在关闭时才解除映射
+            int closeRet = closeFile(info->fid);
+            closeRet |= closeFile(idx->fid);
+            closeRet |= closeFile(varchar->fid);
+            if(closeRet != 0)
+                printf("In Database::Close, error when closing reserved tables\n");
             delete info;
             delete idx;
             delete varchar;
             delete rec;
             delete rid;
             for(auto it = activeTables.begin(); it != activeTables.end(); it++){
-                (*it)->WriteBack();
-                int closeRet = fm->closeFile((*it)->fid);
+                if(!(*it)->WriteBack()){
+                    printf("In Database::Close, cannot write back table\n");
+                    ok = false;
+                }
+                int closeRet = closeFile((*it)->fid);
                 delete *it;
                 if(closeRet != 0)
                     printf("In Database::Close, error when closing table\n");
             }
             activeTables.clear();
+            if(log != nullptr){
+                // 所有页面都已经写回, 落盘后日志就不再需要了. 有页面写回失败时保留日志, 下次打开时重做
+                if(ok)
+                    log->Truncate();
+                bpm->setLog(nullptr);
+                delete log;
+                log = nullptr;
+            }
         }
 
         const char* GetName(){
             return name;
         }
+
+        // 只读打开或者日志不可用时返回nullptr
+        LogManager* GetLog(){
+            return log;
+        }
+
+        bool IsReadOnly(){
+            return readOnly;
+        }
 };
 #endif
\ No newline at end of file
@@ -16,8 +16,11 @@ class Header : public BaseHeader{
         // uint recordNum = 0;
         // uint exploitedNum = 0;// If a table's slots are: 1 0 0 1 0 1 0 0 0 0..., then the exploitedNum is 6 while recordNum is 3. 0 for empty
         // uint nullMask = 0;
-        uint primaryKeyMask = 0; // ! unused. Use primaryKeyID instead, the corresponsing primary constraint name is the same as primary index name
-        uint foreignKeyMask = 0; // ! unused. Use fkMaster, masterKeyID, slaveKeyID, constraintName instead
+        // 它之前的槽位都已经被占用, 插入时从这里开始找空闲的槽位, 见Table::firstZeroBit
+        // 原来是没有用过的primaryKeyMask, 以前建的表这里可能不是0, options中有FreeHint时才有效
+        uint freeHint = 0;
+        // 表的选项, 见Header::Compressed. 原来是没有用过的foreignKeyMask, 以前建的表这里都是0
+        uint options = 0;
         uint defaultKeyMask = 0; // The template record for `default` is always stored as (1, 0) and is invisible & inchangable by query
         // 主键索引b+树的header页
         uint primaryIndexPage = 0;
@@ -57,6 +60,13 @@ class Header : public BaseHeader{
         // b+树的RID
         uint bpTreePage[MAX_INDEX_NUM] = {0};
 
+        // options中的位: 页面压缩后写入文件, 见FileManager::setCompression
+        const static uint Compressed = 1;
+        // options中的位: freeHint有效
+        const static uint FreeHint = 2;
+        // options中的位: 数据页是变长记录的slotted page, 见SlottedPage. 这时freeHint是插入时先尝试的数据页(从0开始)
+        const static uint Slotted = 4;
+
         Header(){
             // set all fkMasters, fkSlaves and indexID to 31, which means invalid table id(none)
             memset(fkMaster, TB_ID_NONE, MAX_REF_SLAVE_TIME);
@@ -107,8 +117,8 @@ class Header : public BaseHeader{
             uintPtr[2] = recordNum;
             uintPtr[3] = exploitedNum;
             uintPtr[4] = nullMask;
-            uintPtr[5] = primaryKeyMask;
-            uintPtr[6] = foreignKeyMask;
+            uintPtr[5] = freeHint;
+            uintPtr[6] = options;
             uintPtr[7] = defaultKeyMask;
             uintPtr[8] = primaryIndexPage;
             uintPtr += 9;
@@ -156,8 +166,8 @@ class Header : public BaseHeader{
             recordNum = uintPtr[2];
             exploitedNum = uintPtr[3];
             nullMask = uintPtr[4];
-            primaryKeyMask = uintPtr[5];
-            foreignKeyMask = uintPtr[6];
+            freeHint = uintPtr[5];
+            options = uintPtr[6];
             defaultKeyMask = uintPtr[7];
             primaryIndexPage = uintPtr[8];
             uintPtr += 9;
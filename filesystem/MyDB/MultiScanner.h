@@ -2,6 +2,7 @@
 #define MULTISCANNER_H
 #include "../utils/pagedef.h"
 #include "../RM/Record.h"
+#include "../RM/RecordView.h"
 #include "../RM/DataType.h"
 #include "Table.h"
 #include "Scanner.h"
@@ -37,12 +38,11 @@ class MultiScanner{
         }
         void PrintSelection(std::vector<uchar>* wantedCols){
             std::vector<RID> rids[scanners.size()];
-            Record tmpRec;
+            RecordView view;
             bool ok = true;
             for(int i = 0; i < scanners.size(); i++){
-                while(scanners[i]->NextRecord(&tmpRec)){
-                    rids[i].push_back(*tmpRec.GetRid());
-                    tmpRec.FreeMemory();
+                while(scanners[i]->NextView(&view)){
+                    rids[i].push_back(*view.GetRid());
                 }
                 if(rids[i].size() == 0){
                     ok = false;
@@ -57,33 +57,41 @@ class MultiScanner{
                         std::string((const char*)scanners[i]->table->GetHeader()->attrName[*it], strnlen((const char*)scanners[i]->table->GetHeader()->attrName[*it], MAX_TABLE_NAME_LEN)));
             }
             uint seq[scanners.size()] = {0};
-            Record recLeft, recRight;
+            RecordView recLeft, recRight;
             while(ok){
                 bool units_ok = true;
                 for(auto unit_it = units.begin(); unit_it != units.end(); unit_it++){
                     int left = unit_it->tableIndexLeft, right = unit_it->tableIndexRight;
-                    scanners[left]->table->GetRecord(rids[left][seq[left]], &recLeft);
-                    scanners[right]->table->GetRecord(rids[right][seq[right]], &recRight);
-                    if(!DataType::compare(recLeft.GetData() + scanners[left]->table->ColOffset(unit_it->colLeft), 
-                        recRight.GetData() + scanners[right]->table->ColOffset(unit_it->colRight), scanners[left]->table->GetHeader()->attrType[unit_it->colLeft], 
-                        scanners[left]->table->GetHeader()->attrLenth[unit_it->colLeft], unit_it->cmp, getBitFromLeft(*(uint*)recLeft.GetData(), unit_it->colLeft), 
-                        getBitFromLeft(*(uint*)recRight.GetData(), unit_it->colRight))){
+                    Table* leftTable = scanners[left]->table;
+                    if(leftTable->GetRecordView(rids[left][seq[left]], &recLeft) == nullptr)
+                        return;
+                    // 两边是同一个表时, 取右边的记录会换掉左边的视图指向的页面, 先把左边复制出来
+                    const uchar* leftData = recLeft.GetData();
+                    uchar leftBuf[leftTable == scanners[right]->table ? leftTable->GetHeader()->recordLenth : 1];
+                    if(leftTable == scanners[right]->table){
+                        memcpy(leftBuf, leftData, sizeof(leftBuf));
+                        leftData = leftBuf;
+                    }
+                    if(scanners[right]->table->GetRecordView(rids[right][seq[right]], &recRight) == nullptr)
+                        return;
+                    if(!DataType::compare(leftData + leftTable->ColOffset(unit_it->colLeft), 
+                        recRight.GetData() + scanners[right]->table->ColOffset(unit_it->colRight), leftTable->GetHeader()->attrType[unit_it->colLeft], 
+                        leftTable->GetHeader()->attrLenth[unit_it->colLeft], unit_it->cmp, getBitFromLeft(*(const uint*)leftData, unit_it->colLeft), 
+                        getBitFromLeft(*(const uint*)recRight.GetData(), unit_it->colRight))){
                         units_ok = false;
                     } // end if
-                    recLeft.FreeMemory();
-                    recRight.FreeMemory();
                     if(!units_ok)
                         break;
                 }
                 if(units_ok){
                     std::vector<std::string> tmpRow;
                     for(int i = 0; i < scanners.size(); i++){ // 第i个表
-                        scanners[i]->table->GetRecord(rids[i][seq[i]], &tmpRec);
+                        if(scanners[i]->table->GetRecordView(rids[i][seq[i]], &view) == nullptr)
+                            return;
                         for(auto it = wantedCols[i].begin(); it != wantedCols[i].end(); it++){ // 这个表内所有需要的字段
-                            tmpRow.push_back(Printer::FieldToStr(tmpRec, scanners[i]->table->GetHeader()->attrType[*it], *it, 
+                            tmpRow.push_back(Printer::FieldToStr(view.GetData(), scanners[i]->table->GetHeader()->attrType[*it], *it, 
                                 scanners[i]->table->GetHeader()->attrLenth[*it], scanners[i]->table->ColOffset(*it)));
                         }
-                        tmpRec.FreeMemory();
                     }
                     printTb.push_back(tmpRow);
                 }
@@ -1,6 +1,6 @@
 #include "Scanner.h"
 
-Scanner* Table::GetScanner(bool (*demand)(const Record& record)){
+Scanner* Table::GetScanner(bool (*demand)(const RecordView& record)){
     return new Scanner(this, demand);
 }
 
@@ -1,6 +1,7 @@
 #ifndef SCANNER_H
 #define SCANNER_H
 #include "../RM/Record.h"
+#include "../RM/RecordView.h"
 #include "Table.h"
 #include "../frontend/Printer.h"
 #include<vector>
@@ -46,14 +47,13 @@ class MultiScanner;
 class Scanner{
     Table* table = nullptr;
     // demand是一个lambda函数,仅在特殊情况才使用,如any -> true
-    bool (*demand)(const Record& record) = nullptr;
+    bool (*demand)(const RecordView& record) = nullptr;
 
     // types and lengths are table properties, unrelated to comparison conditions
     uchar types[MAX_COL_NUM] = {0};
     ushort lengths[MAX_COL_NUM] = {0};
 
     RID* rid = new RID(START_PAGE, 0);
-    Record* record = nullptr;
 
     struct SelfCmp{
         // left和right是字段下标
@@ -72,7 +72,7 @@ class Scanner{
     uchar mode = uninitialized;
     // lambda style Scanner
     // 如果要构造空Scanner请使用Scanner(Table, nullptr)而非Scanner(Table, nullptr, 0, nullptr)
-    Scanner(Table* table, bool (*demand)(const Record& record)){
+    Scanner(Table* table, bool (*demand)(const RecordView& record)){
         this->table = table;
         memcpy(this->types, table->GetHeader()->attrType, table->ColNum());
         memcpy(this->lengths, table->GetHeader()->attrLenth, table->ColNum() * sizeof(ushort));
@@ -88,45 +88,56 @@ class Scanner{
     }
     public:
         /**
-         * Return the next record that meets requirements 'demand', or nullptr if none is found
-         * No memory is dynamically allocated
+         * Return a view of the next record that meets requirements 'demand', or nullptr if none is found
+         * Records are filtered in place in the pinned page, nothing is copied or allocated, see RecordView
         */
-        Record* NextRecord(Record* rec){
+        RecordView* NextView(RecordView* view){
             if(mode == uninitialized){
                 printf("uninitialized scanner\n");
                 return nullptr;
             }
             while(table->NextRecord(*rid)){
-                record = table->GetRecord(*rid, rec); // Memory needs to be released
+                if(table->GetRecordView(*rid, view) == nullptr) // the page cannot be read, stop scanning
+                    return nullptr;
+                const uchar* data = view->GetData();
                 bool ok = true;
                 if(mode == lambda){
-                    if(!demand(*record))
+                    if(!demand(*view))
                         ok = false;
                 }
                 else{
                     for(auto cmp_it = units.begin(); cmp_it != units.end(); cmp_it++)
-                        if(!DataType::compareArrMultiOp(record->GetData(), cmp_it->right, types, lengths, cmp_it->colNum, cmp_it->cmp, false, true)){
+                        if(!DataType::compareArrMultiOp(data, cmp_it->right, types, lengths, cmp_it->colNum, cmp_it->cmp, false, true)){
                             ok = false;
                             break;
                         }
                 }
                 if(ok)
                     for(auto it = selfs.begin(); it != selfs.end(); it++){
-                        if(!DataType::CompareFamily(types[it->left], types[it->right], record->GetData() + table->ColOffset(it->left), record->GetData() + table->ColOffset(it->right), 
-                            lengths[it->left], lengths[it->right], getBitFromLeft(*(uint*)record->GetData(), it->left), getBitFromLeft(*(uint*)record->GetData(), it->right), it->cmp)){
+                        if(!DataType::CompareFamily(types[it->left], types[it->right], data + table->ColOffset(it->left), data + table->ColOffset(it->right), 
+                            lengths[it->left], lengths[it->right], getBitFromLeft(*(const uint*)data, it->left), getBitFromLeft(*(const uint*)data, it->right), it->cmp)){
                             ok = false;
                             break;
                         }
                     }
                 if(ok)
-                    return record;
-                record->FreeMemory();
-                record = nullptr;
+                    return view;
             }
             return nullptr;
         }
 
-        void SetDemand(bool(*demand)(const Record& record)){
+        /**
+         * Return a COPY of the next record that meets requirements 'demand', or nullptr if none is found
+         * Only records that meet requirements are copied into rec, which frees them
+        */
+        Record* NextRecord(Record* rec){
+            RecordView view;
+            if(NextView(&view) == nullptr)
+                return nullptr;
+            return table->GetRecord(*view.GetRid(), rec);
+        }
+
+        void SetDemand(bool(*demand)(const RecordView& record)){
             units.clear();
             if(demand != nullptr)
                 this->mode = lambda;
@@ -191,11 +202,11 @@ class Scanner{
             for(auto select_it = selected.begin(); select_it != selected.end(); select_it++)
                 tb[0].push_back(std::string((char*)table->GetHeader()->attrName[*select_it], strnlen((char*)table->GetHeader()->attrName[*select_it], MAX_ATTRI_NAME_LEN)));
             int rowCount = 1; // the top row
-            Record tmpRec;
-            while(NextRecord(&tmpRec)){
+            RecordView view;
+            while(NextView(&view)){
                 std::vector<std::string> tmpRow;
                 for(auto select_it = selected.begin(); select_it != selected.end(); select_it++)
-                    tmpRow.push_back(Printer::FieldToStr(tmpRec, table->GetHeader()->attrType[*select_it], *select_it, table->GetHeader()->attrLenth[*select_it], table->ColOffset(*select_it)));
+                    tmpRow.push_back(Printer::FieldToStr(view.GetData(), table->GetHeader()->attrType[*select_it], *select_it, table->GetHeader()->attrLenth[*select_it], table->ColOffset(*select_it)));
                 tb.push_back(std::move(tmpRow));
                 rowCount++;
             }
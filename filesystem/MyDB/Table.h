@@ -2,10 +2,15 @@
 #define TABLE_H
 #include "Header.h"
 #include "../RM/Record.h"
+#include "../RM/RecordView.h"
+#include "../RM/SlottedPage.h"
 #include "../bufmanager/BufPageManager.h"
+#include "../bufmanager/PageGuard.h"
+#include "../bufmanager/BulkAccess.h"
+#include "../bufmanager/LogGroup.h"
 #include "../RM/SimpleUtils.h"
+#include "../utils/BitScan.h"
 #include <vector>
-#include <queue>
 #include <string>
 #include <cassert>
 #include <fstream>
@@ -22,8 +27,17 @@ class Table{
     char tablename[MAX_TABLE_NAME_LEN + 1] = "";
     int tmpIdx = 0;
     uchar* tmpBuf = nullptr;
+    int bitmapIdx = 0;
     Database* db = nullptr;
 
+    /**
+     * 表头页在表打开期间一直被钉住, 位图页(1 ~ START_PAGE - 1)和当前数据页各由一个PageGuard钉住
+     * 连续访问同一页时只比较页号, 不需要getKey + reusePage的检查
+    */
+    PageGuard headerGuard;
+    PageGuard bitmapGuard;
+    PageGuard tmpGuard;
+
     // table ID, sometimes useful...
     uchar tableID;
 
@@ -37,152 +51,155 @@ class Table{
     int idxCount = 0;
     bool headerDirty = false;
     uint offsets[MAX_COL_NUM] = {0};
+    // 位图的摘要, 见buildGroups
+    std::vector<ull> fullGroups;
+    bool groupsBuilt = false;
+    // 位图每次变化时加一
+    uint bitmapVersion = 0;
+    // NextRecord在slotsPage页中找到的有记录的槽位, 由CollectSlots一次取出, bitmapVersion变化后重新取
+    std::vector<uint> slotsCache;
+    int slotsPage = -1;
+    uint slotsVersion = 0;
+    size_t slotsPos = 0;
+    // 变长记录的表(见SlottedPage)中, GetRecordView把记录还原到rowBuf, 写入前编码到tupleBuf
+    std::vector<uchar> rowBuf;
+    std::vector<uchar> tupleBuf;
+
+    uchar* pinHeader(){
+        headerBuf = headerGuard.Fetch(bpm, fid, 0);
+        headerIdx = headerGuard.Index();
+        return headerBuf;
+    }
+
+    uchar* pinBitmap(int page){
+        uchar* buf = bitmapGuard.Fetch(bpm, fid, page);
+        bitmapIdx = bitmapGuard.Index();
+        return buf;
+    }
+
+    uchar* pinData(int page){
+        tmpBuf = tmpGuard.Fetch(bpm, fid, page);
+        tmpIdx = tmpGuard.Index();
+        return tmpBuf;
+    }
+
+    void releaseGuards(){
+        headerGuard.Release();
+        bitmapGuard.Release();
+        tmpGuard.Release();
+    }
+
+    //private helper methods
+    /**
+     * 读出位图中第g组的64个槽位(从64g开始), 第一个槽位在最高位, 和位图中字节内的顺序相同
+     * 跨页的组逐个字节读
+    */
+    ull loadGroup(int g){
+        int bytes = header->GetLenth() + (g << 3);
+        int curPage = bytes / PAGE_SIZE, localPos = bytes % PAGE_SIZE;
+        uchar* src = curPage == 0 ? pinHeader() : pinBitmap(curPage);
+        if(localPos + 8 <= PAGE_SIZE)
+            return bitScanLoad(src + localPos);
+        ull word = 0;
+        for(int i = 0; i < 8; i++, localPos++){
+            if(localPos == PAGE_SIZE){
+                localPos = 0;
+                src = ++curPage < START_PAGE ? pinBitmap(curPage) : nullptr;
+            }
+            word = (word << 8) | (src != nullptr ? src[localPos] : 0);
+        }
+        return word;
+    }
 
     /**
-     * 用于跟踪tmpBuf和tmpIdx,以便针对性地释放缓存
+     * fullGroups中第g位为1表示第g组的64个槽位都被占用, 是位图的摘要, 找空闲槽位时先在这里找没有满的组
+     * 在第一次需要时由位图生成, 之后由setBit和clearBit维护, 只在表打开期间有效
     */
-    struct BufTracker{
-        uint page;
-        int idx;
-        BufTracker(uint page, int idx):page(page), idx(idx){};
-    };
-
-    std::queue<BufTracker> trackers;
-
-    void WriteBackTracker(const BufTracker& tracker){
-        int curPage, curFid;
-        bpm->getKey(tracker.idx, curFid, curPage);
-        if(fid == curFid && tracker.page == curPage)
-            bpm->writeBack(tracker.idx);
+    void buildGroups(){
+        int groups = (header->exploitedNum + 63) >> 6;
+        fullGroups.assign((groups + 63) >> 6, 0);
+        int hintGroup = header->freeHint >> 6;
+        for(int g = 0; g < groups; g++)
+            if(g < hintGroup || loadGroup(g) == ~0ULL)
+                fullGroups[g >> 6] |= 1ULL << (g & 63);
+        groupsBuilt = true;
     }
 
-    void PushTracker(const BufTracker& tracker){
-        if(trackers.size() == MAX_TABLE_BUF_SIZE){
-            WriteBackTracker(trackers.front());
-            trackers.pop();
-        }
-        trackers.push(tracker);
+    void updateGroup(int pos){
+        if(!groupsBuilt)
+            return;
+        int g = pos >> 6;
+        if((size_t)(g >> 6) >= fullGroups.size())
+            fullGroups.resize((g >> 6) + 1, 0);
+        if(loadGroup(g) == ~0ULL)
+            fullGroups[g >> 6] |= 1ULL << (g & 63);
+        else
+            fullGroups[g >> 6] &= ~(1ULL << (g & 63));
     }
 
-    //private helper methods
     /**
      * Find the first 0 bit in the bit map
      * We assume bits are stored from higher digits to lower ones in a byte
      * Convert it to RID if needed
      * The index starts from 0
+     * 没有空洞(recordNum == exploitedNum)时直接返回exploitedNum
+     * 否则header->freeHint之前都已经被占用, 从它所在的组开始在fullGroups中找第一个没有满的组, 再在组内找第一个0
+     * 一次查找最多读exploitedNum / 4096个摘要字和几个位图组
     */
     int firstZeroBit(){
-        headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
-        uchar* src = headerBuf;
         int size = header->exploitedNum;
-        int globalEnd = (size >> 3) + header->GetLenth();
-        int localPos = header->GetLenth(), globalPos = header->GetLenth();
-        int curPage = 0;
-        while(globalPos < globalEnd){
-            if(src[localPos] != 0xff){
-                for(int i = 0; i < 8; i++)
-                    if((src[localPos] & (0x80 >> i)) == 0)
-                        return ((globalPos - header->GetLenth()) << 3) + i;
-                assert(false);
-            }
-            globalPos++;
-            localPos++;
-            if(localPos == PAGE_SIZE){
-                localPos = 0;
-                src = tmpBuf = bpm->reusePage(fid, ++curPage, tmpIdx, tmpBuf);
+        if(header->recordNum >= (uint)size)
+            return size;
+        if(!groupsBuilt)
+            buildGroups();
+        for(size_t w = header->freeHint >> 12; w < fullGroups.size(); w++){
+            while(~fullGroups[w] != 0){
+                int g = (w << 6) + __builtin_ctzll(~fullGroups[w]);
+                ull word = loadGroup(g);
+                if(~word != 0)
+                    return std::min((g << 6) + __builtin_clzll(~word), size);
+                fullGroups[w] |= 1ULL << (g & 63);
             }
         }
-        int remain = size & 7;
-        for(int i = 0; i < remain; i++)
-            if(src[localPos] & (0x80 >> i) == 0)
-                return ((globalPos - header->GetLenth()) << 3) + i;
         return size;
+    }
 
-        // uchar* src = headerBuf + header->GetLenth();
-        // int size = header->exploitedNum;
-        // int fullByte = size >> 3;
-        // uchar allOnes = 255;
-        // for(int i = 0; i < fullByte; i++){
-        //     if(src[i] != allOnes){
-        //         int pos = 0;
-        //         uchar msb = 128;
-        //         while(src[i] & msb){
-        //             pos++;
-        //             msb >>= 1;
-        //         }
-        //         return (i << 3) + pos;
-        //     }
-        // }
-        // int pos = 0, remain = size & 7;
-        // uchar msb = 128;
-        // src += fullByte;
-        // while((src[0] & msb) && pos < remain){
-        //     pos++;
-        //     msb >>= 1;
-        // }
-        // return pos + (fullByte << 3);
-
-        //If pos < remain, there is an empty slot before the furthest record
-        //otherwise, pos == remain, it points to the empty slot right after the furthest record. The the return value equals header->exploitedNum
+    /**
+     * 对位图中槽位[from, to)经过的每个页面调用visit(src, begin, end, base)
+     * src为页面的内容, 这一段是页面中的第[begin, end)位, 第begin位对应槽位base
+     * visit返回true时停止并返回true, 页面读不出来时返回false
+    */
+    template<class Visit>
+    bool visitBitmap(int from, int to, Visit visit){
+        const int pageBits = PAGE_SIZE << 3;
+        int offset = header->GetLenth() << 3;
+        while(from < to){
+            int global = offset + from;
+            int curPage = global / pageBits, begin = global % pageBits;
+            int end = std::min(pageBits, begin + (to - from));
+            uchar* src = curPage == 0 ? pinHeader() : pinBitmap(curPage);
+            if(src == nullptr)
+                return false;
+            if(visit(src, begin, end, from))
+                return true;
+            from += end - begin;
+        }
+        return false;
     }
 
     /**
      * Returns the position of the first 1 bit starting from pos(included), or -1 if non exists
     */
     int firstOneBitFrom(int pos){
-        int startByte = (pos >> 3) + header->GetLenth(), startBit = pos & 7;
-        int endByte = (header->exploitedNum >> 3) + header->GetLenth(), endBit = header->exploitedNum & 7;
-        if(startByte > endByte)
-            return -1;
-        int curPage = startByte / PAGE_SIZE, localPos = startByte % PAGE_SIZE;
-        uchar* src = nullptr;
-        if(curPage == 0)
-            src = headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
-        else
-            src = tmpBuf = bpm->reusePage(fid, curPage, tmpIdx, tmpBuf);
-        //[(startBytes, startBit), (startByte, endBit))
-        if(startByte == endByte){
-            for(int i = startBit; i < endBit; i++)
-                if(src[localPos] & (0x80 >> i))
-                    return ((startByte - header->GetLenth()) << 3) + i;
-            return -1;
-        }
-
-        //[(startByte, startBit), (startByte, 8))
-        for(int i = startBit; i < 8; i ++){
-            if(src[localPos] & (0x80 >> i))
-                return ((startByte - header->GetLenth()) << 3) + i;
-        }
-        localPos++;
-        if(localPos == PAGE_SIZE){
-            localPos = 0;
-            src = tmpBuf = bpm->reusePage(fid, ++curPage, tmpIdx, tmpBuf);
-        }
-
-        //[(startByte + 1, 0), (endByte - 1, 8))
-        for(int i = startByte + 1; i < endByte; i++){
-            if(src[localPos]){
-                for(int j = 0; j < 8; j++){
-                    if(src[localPos] & (0x80 >> j))
-                        return ((i - header->GetLenth()) << 3) + j;
-                }
-                assert(false);
-            }
-            else{
-                localPos++;
-                if(localPos == PAGE_SIZE){
-                    localPos = 0;
-                    src = tmpBuf = bpm->reusePage(fid, ++curPage, tmpIdx, tmpBuf);
-                }
-            }
-        }
-
-        //[(endByte, 0), (endByte, endBit))
-        for(int i = 0; i < endBit; i++){
-            if(src[localPos] & (0x80 >> i))
-                return ((endByte - header->GetLenth()) << 3) + i;
-        }
-        return -1;
+        int ans = -1;
+        visitBitmap(pos, header->exploitedNum, [&ans](const uchar* src, int begin, int end, int base){
+            int bit = bitScanFirst(src, begin, end, true);
+            if(bit < 0)
+                return false;
+            ans = base + bit - begin;
+            return true;
+        });
+        return ans;
     }
 
     /**
@@ -193,16 +210,31 @@ class Table{
         int dstPage = bytes / PAGE_SIZE, localPos = bytes % PAGE_SIZE;
         uchar* src = nullptr;
         if(dstPage == 0){
-            src = headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
+            src = pinHeader();
             bpm->markDirty(headerIdx); // ? headerDirty,这里更改了buffer中的内容,只能通过bpm写回
-            // ? trackers不记录header page的信息,因为header page不需要跟踪
         }
         else{
-            src = tmpBuf = bpm->reusePage(fid, dstPage, tmpIdx, tmpBuf);
-            bpm->markDirty(tmpIdx);
-            PushTracker(BufTracker(dstPage, tmpIdx));
+            src = pinBitmap(dstPage);
+            bpm->markDirty(bitmapIdx);
         }
         (*(src + localPos)) |= (0x80 >> remain);
+        bitmapVersion++;
+        updateGroup(pos);
+    }
+
+    /**
+     * 把槽位[from, to)都置为1, 按整字节写位图
+     * 位图变化导致的内存的markDirty和headerDirty由该函数维护
+    */
+    void setBits(int from, int to){
+        visitBitmap(from, to, [this](uchar* src, int begin, int end, int){
+            bitFill(src, begin, end);
+            bpm->markDirty(src == headerBuf ? headerIdx : bitmapIdx);
+            return false;
+        });
+        bitmapVersion++;
+        for(int g = from >> 6; g <= (to - 1) >> 6; g++)
+            updateGroup(g << 6);
     }
 
     /**
@@ -213,15 +245,29 @@ class Table{
         int dstPage = bytes / PAGE_SIZE, localPos = bytes % PAGE_SIZE;
         uchar* src = nullptr;
         if(dstPage == 0){
-            src = headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
+            src = pinHeader();
             bpm->markDirty(headerIdx);
         }
         else{
-            src = tmpBuf = bpm->reusePage(fid, dstPage, tmpIdx, tmpBuf);
-            bpm->markDirty(tmpIdx);
-            PushTracker(BufTracker(dstPage, tmpIdx));
+            src = pinBitmap(dstPage);
+            bpm->markDirty(bitmapIdx);
         }
         (*(src + localPos)) &= ~(0x80 >> remain);
+        bitmapVersion++;
+        updateGroup(pos);
+    }
+
+    /**
+     * 把recordNum、exploitedNum、freeHint和options写入表头页(位置见Header::ToString)
+     * 和位图页、数据页的修改在同一组日志中, 恢复后记录数和位图一致
+    */
+    void syncCounts(){
+        uint* dst = (uint*)pinHeader();
+        dst[2] = header->recordNum;
+        dst[3] = header->exploitedNum;
+        dst[5] = header->freeHint;
+        dst[6] = header->options;
+        bpm->markDirty(headerIdx);
     }
 
     uint RIDtoUint(const RID* rid){
@@ -234,6 +280,220 @@ class Table{
         return rid;
     }
 
+    /**
+     * 位图最多能表示的槽位数
+    */
+    int capacity(){
+        return ((START_PAGE << PAGE_SIZE_IDX) - header->GetLenth()) << 3;
+    }
+
+    /* 变长记录的表, 见SlottedPage
+     * RID和槽位号的换算和定长的表相同, 每页最多header->slotNum个槽位, 位图中只有记录原来所在的槽位置位
+     * 因此位图、NextRecord和CollectSlots都不用改, 记录搬到别的页之后RID也不变
+    */
+
+    int encodeRow(const uchar* src){
+        return SlottedPage::Encode(header->attrType, header->attrLenth, colCount, src, tupleBuf.data());
+    }
+
+    void decodeRow(const uchar* src, uchar* dst){
+        SlottedPage::Decode(header->attrType, header->attrLenth, colCount, src, dst, header->recordLenth);
+    }
+
+    /**
+     * 钉住第page页并在第一次使用时初始化
+    */
+    uchar* pinSlotted(int page){
+        if(pinData(page) == nullptr)
+            return nullptr;
+        if(SlottedPage::DataStart(tmpBuf) == 0){
+            SlottedPage::Init(tmpBuf);
+            bpm->markDirty(tmpIdx);
+        }
+        return tmpBuf;
+    }
+
+    /**
+     * 记录现在所在的位置: 没有搬走时就是rid, 否则是Forward指向的位置
+     * 返回false表示槽位没有记录或者页面读不出来
+    */
+    bool locate(const RID& rid, RID& at){
+        uchar* page = pinData(rid.PageNum);
+        if(page == nullptr || !SlottedPage::Used(page, rid.SlotNum))
+            return false;
+        at = rid;
+        if(SlottedPage::Flags(page, rid.SlotNum) & SlottedPage::Forward){
+            uint target[2];
+            memcpy(target, SlottedPage::Data(page, rid.SlotNum), sizeof(target));
+            at.PageNum = target[0];
+            at.SlotNum = target[1];
+        }
+        return true;
+    }
+
+    /**
+     * 返回rid的记录编码后的内容, 所在的页由tmpGuard钉住, 失败时返回nullptr
+    */
+    uchar* slottedTuple(const RID& rid, RID& at){
+        if(!locate(rid, at))
+            return nullptr;
+        uchar* page = pinData(at.PageNum);
+        if(page == nullptr || !SlottedPage::Used(page, at.SlotNum))
+            return nullptr;
+        return SlottedPage::Data(page, at.SlotNum);
+    }
+
+    /**
+     * 找一个能放下len字节新记录的数据页, 返回页号, 页面由tmpGuard钉住, 表满时返回-1, 由调用者报告
+     * 先试freeHint, 再从最后一个有记录的槽位所在的页往后找, 跳过第avoid页. 找到的页成为新的freeHint
+    */
+    int findSlottedPage(int len, int avoid){
+        int pages = capacity() / header->slotNum;
+        auto fits = [&](int p){
+            if(p + START_PAGE == avoid || pinSlotted(p + START_PAGE) == nullptr)
+                return false;
+            return SlottedPage::Fits(tmpBuf, len, header->slotNum);
+        };
+        if((int)header->freeHint < pages && fits(header->freeHint))
+            return header->freeHint + START_PAGE;
+        int last = header->exploitedNum == 0 ? 0 : (header->exploitedNum - 1) / header->slotNum;
+        for(int p = last; p < pages; p++)
+            if(p != (int)header->freeHint && fits(p)){
+                header->freeHint = p;
+                return p + START_PAGE;
+            }
+        return -1;
+    }
+
+    /**
+     * 把tupleBuf中len字节的记录放到一个新的槽位, 返回它的位置, 页面放不下时返回false
+    */
+    bool placeTuple(int len, int avoid, ushort flags, RID& at){
+        int page = findSlottedPage(len, avoid);
+        if(page < 0)
+            return false;
+        int slot = SlottedPage::FindSlot(tmpBuf, header->slotNum);
+        memcpy(SlottedPage::Alloc(tmpBuf, slot, len, flags), tupleBuf.data(), len);
+        bpm->markDirty(tmpIdx);
+        at.PageNum = page;
+        at.SlotNum = slot;
+        return true;
+    }
+
+    RID* insertSlotted(const uchar* data, RID* rid){
+        LogGroup group(bpm);
+        RID at;
+        if(!placeTuple(encodeRow(data), -1, 0, at)){
+            printf("In Table::InsertRecord, table %s is full\n", tablename);
+            return nullptr;
+        }
+        int slotNumber = RIDtoUint(&at);
+        setBit(slotNumber);
+        header->recordNum++;
+        if((uint)slotNumber >= header->exploitedNum)
+            header->exploitedNum = slotNumber + 1;
+        syncCounts();
+        *rid = at;
+        return rid;
+    }
+
+    /**
+     * 更新变长记录: 变短或者原来的页放得下时原地更新
+     * 否则搬回原来的槽位(放得下时)或者搬到别的页, 原来的槽位改成Forward, 记录最多只跳一次
+     * 失败时返回false, 记录保持原来的值
+    */
+    bool updateSlotted(const RID& rid, const uchar* data, uint dstOffset, uint srcOffset, uint length){
+        LogGroup group(bpm);
+        RID at;
+        uchar* tuple = slottedTuple(rid, at);
+        if(tuple == nullptr){
+            printf("In Table::UpdateRecord, no record at (%u, %u)\n", rid.PageNum, rid.SlotNum);
+            return false;
+        }
+        decodeRow(tuple, rowBuf.data());
+        memcpy(rowBuf.data() + dstOffset, data + srcOffset, length);
+        int len = encodeRow(rowBuf.data());
+        bool moved = at.PageNum != rid.PageNum || at.SlotNum != rid.SlotNum;
+        uchar* page = tmpBuf;
+        ushort flags = SlottedPage::Flags(page, at.SlotNum);
+        int size = SlottedPage::Size(page, at.SlotNum);
+        if(SlottedPage::AllocLen(len) <= size){
+            memcpy(SlottedPage::Data(page, at.SlotNum), tupleBuf.data(), len);
+            SlottedPage::Shrink(page, at.SlotNum, len, flags);
+            bpm->markDirty(tmpIdx);
+            return true;
+        }
+        if(SlottedPage::FreeBytes(page) + size >= SlottedPage::AllocLen(len)){
+            SlottedPage::Release(page, at.SlotNum);
+            memcpy(SlottedPage::Alloc(page, at.SlotNum, len, flags), tupleBuf.data(), len);
+            bpm->markDirty(tmpIdx);
+            return true;
+        }
+        // 原来的页放不下, 先试着搬回原来的槽位
+        if(moved){
+            uchar* home = pinData(rid.PageNum);
+            if(home == nullptr){
+                printf("In Table::UpdateRecord, cannot read page %u\n", rid.PageNum);
+                return false;
+            }
+            if(SlottedPage::FreeBytes(home) + SlottedPage::Size(home, rid.SlotNum) >= SlottedPage::AllocLen(len)){
+                SlottedPage::Release(home, rid.SlotNum);
+                memcpy(SlottedPage::Alloc(home, rid.SlotNum, len, 0), tupleBuf.data(), len);
+                bpm->markDirty(tmpIdx);
+                // 搬走之后的位置读不出来时只是浪费了它占用的空间
+                if(pinData(at.PageNum) != nullptr){
+                    SlottedPage::Free(tmpBuf, at.SlotNum);
+                    bpm->markDirty(tmpIdx);
+                }
+                return true;
+            }
+        }
+        RID target;
+        if(!placeTuple(len, at.PageNum, SlottedPage::Moved, target)){
+            printf("In Table::UpdateRecord, table %s is full\n", tablename);
+            return false;
+        }
+        // 先在原来的槽位写上Forward, 写不了时撤销刚放下的记录
+        if(pinData(rid.PageNum) == nullptr){
+            if(pinData(target.PageNum) != nullptr){
+                SlottedPage::Free(tmpBuf, target.SlotNum);
+                bpm->markDirty(tmpIdx);
+            }
+            printf("In Table::UpdateRecord, cannot read page %u\n", rid.PageNum);
+            return false;
+        }
+        uint forward[2] = {target.PageNum, target.SlotNum};
+        SlottedPage::Shrink(tmpBuf, rid.SlotNum, sizeof(forward), SlottedPage::Forward);
+        memcpy(SlottedPage::Data(tmpBuf, rid.SlotNum), forward, sizeof(forward));
+        bpm->markDirty(tmpIdx);
+        if(moved && pinData(at.PageNum) != nullptr){
+            SlottedPage::Free(tmpBuf, at.SlotNum);
+            bpm->markDirty(tmpIdx);
+        }
+        syncCounts(); // freeHint可能变了
+        return true;
+    }
+
+    /**
+     * 删除变长记录在数据页中占用的空间, 包括搬走之后的位置
+    */
+    bool deleteSlotted(const RID& rid){
+        RID at;
+        if(!locate(rid, at)){
+            printf("In Table::DeleteRecord, no record at (%u, %u)\n", rid.PageNum, rid.SlotNum);
+            return false;
+        }
+        if(at.PageNum != rid.PageNum || at.SlotNum != rid.SlotNum){
+            pinData(at.PageNum);
+            SlottedPage::Free(tmpBuf, at.SlotNum);
+            bpm->markDirty(tmpIdx);
+            pinData(rid.PageNum);
+        }
+        SlottedPage::Free(tmpBuf, rid.SlotNum);
+        bpm->markDirty(tmpIdx);
+        return true;
+    }
+
     public:
 #ifdef DEBUG
         void DebugPrint(){ // ! Don't use me
@@ -256,12 +516,20 @@ class Table{
         Table(int fid, const char* tableName, Database* db, uchar tableID = TB_ID_NONE){
             header = new Header();
             this->fid = fid;
-            headerBuf = (uchar*)bpm->getPage(fid, 0, headerIdx);
-            bpm->access(headerIdx);
-            header->FromString(headerBuf);
+            header->FromString(pinHeader());
+            // 以前建的表没有freeHint, 从头开始找
+            if(!(header->options & Header::FreeHint) || header->freeHint > header->exploitedNum){
+                header->freeHint = 0;
+                header->options |= Header::FreeHint;
+            }
+            fm->setCompression(fid, header->options & Header::Compressed);
             strncpy(this->tablename, tableName, strnlen(tableName, MAX_TABLE_NAME_LEN));
             CalcColFkIdxCount();
             DataType::calcOffsets(header->attrType, header->attrLenth, colCount, offsets);
+            if(IsSlotted()){
+                rowBuf.resize(header->recordLenth);
+                tupleBuf.resize(SlottedPage::MaxLen(header->attrType, header->attrLenth, colCount));
+            }
             this->db = db;
             this->tableID = tableID;
         }
@@ -278,14 +546,52 @@ class Table{
                 printf("In Table::GetRecord, trying to get record from the header page or bitmap pages\n");
                 return nullptr;
             }
-            tmpBuf = bpm->reusePage(fid, rid.GetPageNum(), tmpIdx, tmpBuf);
-            PushTracker(BufTracker(rid.PageNum, tmpIdx));
+            if(IsSlotted()){
+                RID at;
+                const uchar* tuple = slottedTuple(rid, at);
+                if(tuple == nullptr)
+                    return nullptr;
+                ans->data = new uchar[header->recordLenth];
+                decodeRow(tuple, ans->data);
+                ans->id = new RID(rid.GetPageNum(), rid.GetSlotNum());
+                return ans;
+            }
+            // 页面读不出来(比如校验和不对)时, 错误已经由FileManager打印
+            if(pinData(rid.GetPageNum()) == nullptr)
+                return nullptr;
             ans->data = new uchar[header->recordLenth];
             memcpy(ans->data, ((uchar*)tmpBuf) + rid.GetSlotNum() * header->recordLenth, header->recordLenth);
             ans->id = new RID(rid.GetPageNum(), rid.GetSlotNum());
             return ans;
         }
 
+        /**
+         * Return a view of the record of rid without copying it, see RecordView
+         * The view points into the page pinned by this table and stays valid until the next access to its data pages
+         * 变长记录的表中记录先还原到表的rowBuf, 视图指向rowBuf, 有效期相同
+        */
+        RecordView* GetRecordView(const RID& rid, RecordView* ans){
+            if(rid.GetPageNum() < START_PAGE){
+                printf("In Table::GetRecordView, trying to get record from the header page or bitmap pages\n");
+                return nullptr;
+            }
+            if(IsSlotted()){
+                RID at;
+                const uchar* tuple = slottedTuple(rid, at);
+                if(tuple == nullptr)
+                    return nullptr;
+                decodeRow(tuple, rowBuf.data());
+                ans->data = rowBuf.data();
+                ans->rid = rid;
+                return ans;
+            }
+            if(pinData(rid.GetPageNum()) == nullptr)
+                return nullptr;
+            ans->data = ((const uchar*)tmpBuf) + rid.GetSlotNum() * header->recordLenth;
+            ans->rid = rid;
+            return ans;
+        }
+
         void ConvertTextToBin(const char* src, uchar* dst, ushort length, uchar type);
 
         bool BatchLoad(const char* filename, char delim);
@@ -293,30 +599,88 @@ class Table{
         /**
          * Return the RID of the inserted record
          * No dynamic memory will be allocated
+         * 表满了时返回nullptr
         */
         RID* InsertRecord(const uchar* data, RID* rid){
+            if(IsSlotted())
+                return insertSlotted(data, rid);
+            LogGroup group(bpm);
             // 更新位图
             int firstEmptySlot = firstZeroBit();
+            if(firstEmptySlot >= capacity()){
+                printf("In Table::InsertRecord, table %s is full\n", tablename);
+                return nullptr;
+            }
             setBit(firstEmptySlot);
             // 更新header
             header->recordNum++;
             if(firstEmptySlot == header->exploitedNum)
                 header->exploitedNum++;
-            headerDirty = true;
+            header->freeHint = firstEmptySlot + 1;
+            syncCounts();
             //inserting the record
             UintToRID(firstEmptySlot, rid);
-            tmpBuf = bpm->reusePage(fid, rid->PageNum, tmpIdx, tmpBuf);
-            PushTracker(BufTracker(rid->PageNum, tmpIdx));
+            pinData(rid->PageNum);
             memcpy(tmpBuf + rid->SlotNum * header->recordLenth, data, header->recordLenth);
             bpm->markDirty(tmpIdx);
             return rid;
         }
 
+        /**
+         * 插入rows中连续存放的n条记录, 第i条的RID放入out[i], 返回插入的条数
+         * 位图中有空洞时先逐条填空洞, 剩下的记录占用exploitedNum之后连续的槽位
+         *   每个数据页中的一段槽位一起处理: 位图按整字节置1, 记录整段memcpy到数据页, 表头只写一次
+         *   每段是一组日志, 一组钉住的页面不会随n增长
+         * 位图放不下更多槽位或者数据页读不出来时停止, 返回已经插入的条数
+         * 变长记录的表逐条插入
+        */
+        int InsertRecords(const uchar* rows, int n, RID* out){
+            int len = header->recordLenth, i = 0;
+            if(IsSlotted()){
+                for(; i < n; i++)
+                    if(InsertRecord(rows + (ll)i * len, out + i) == nullptr)
+                        break;
+                return i;
+            }
+            for(; i < n && header->recordNum < header->exploitedNum; i++)
+                if(InsertRecord(rows + (ll)i * len, out + i) == nullptr)
+                    return i;
+            while(i < n){
+                LogGroup group(bpm);
+                int first = header->exploitedNum;
+                int page = first / header->slotNum + START_PAGE, slot = first % header->slotNum;
+                int count = std::min(n - i, (int)header->slotNum - slot);
+                if(first + count > capacity())
+                    count = capacity() - first;
+                if(count <= 0){
+                    printf("In Table::InsertRecords, table %s is full\n", tablename);
+                    return i;
+                }
+                if(pinData(page) == nullptr)
+                    return i;
+                memcpy(tmpBuf + slot * len, rows + (ll)i * len, (size_t)count * len);
+                bpm->markDirty(tmpIdx);
+                setBits(first, first + count);
+                header->recordNum += count;
+                header->exploitedNum += count;
+                header->freeHint = header->exploitedNum;
+                syncCounts();
+                for(int k = 0; k < count; k++, i++){
+                    out[i].PageNum = page;
+                    out[i].SlotNum = slot + k;
+                }
+            }
+            return n;
+        }
+
         void DeleteRecord(const RID& rid){
             if(rid.GetPageNum() < START_PAGE){
                 printf("In Table::DeleteRecord, trying to delete a record from header page or bitmap pages\n");
                 return;
             }
+            LogGroup group(bpm);
+            if(IsSlotted() && !deleteSlotted(rid))
+                return;
             // 更新位图
             int slotNumber = RIDtoUint(&rid);
             clearBit(slotNumber);
@@ -324,23 +688,34 @@ class Table{
             if(slotNumber == header->exploitedNum - 1)
                 header->exploitedNum--;
             header->recordNum--;
-            headerDirty = true;
-            // 和实际记录页没有关系,不需要重新格式化内存
+            // 变长记录的表中freeHint是页号
+            uint hint = IsSlotted() ? rid.PageNum - START_PAGE : slotNumber;
+            if(hint < header->freeHint)
+                header->freeHint = hint;
+            syncCounts();
+            // 定长记录和实际记录页没有关系,不需要重新格式化内存
         }
 
         /**
          * 更新由RID指定的记录
          * 从data的srcOffset开始的length个字节被复制到对应记录从dstOffset开始的length个字节
+         * 失败(页面读不出来, 变长记录的表放不下变长的记录)时返回false, 记录不变
         */
-        void UpdateRecord(const RID& rid, const uchar* data, uint dstOffset, uint srcOffset, uint length){
+        bool UpdateRecord(const RID& rid, const uchar* data, uint dstOffset, uint srcOffset, uint length){
             if(rid.PageNum == 0){
                 printf("In Table::UpdateRecord, trying to update a record from header page\n");
-                return;
+                return false;
+            }
+            if(IsSlotted())
+                return updateSlotted(rid, data, dstOffset, srcOffset, length);
+            LogGroup group(bpm);
+            if(pinData(rid.PageNum) == nullptr){
+                printf("In Table::UpdateRecord, cannot read page %u\n", rid.PageNum);
+                return false;
             }
-            tmpBuf = bpm->reusePage(fid, rid.PageNum, tmpIdx, tmpBuf);
-            PushTracker(BufTracker(rid.PageNum, tmpIdx));
             memcpy(tmpBuf + rid.SlotNum * header->recordLenth + dstOffset, data + srcOffset, length);
             bpm->markDirty(tmpIdx);
+            return true;
         }
 
 
@@ -417,7 +792,7 @@ class Table{
          * Remove foreign constraint master, return if success
         */
         bool RemoveFKMaster(const char* fkName, uchar& masterID){
-            headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
+            pinHeader();
             // uchar* fkPart = headerBuf + Header::fkOffset + MAX_REF_SLAVE_TIME * 9;
             int pos = 0;
             for(; pos < fkMasterCount; pos++){
@@ -449,7 +824,7 @@ class Table{
         bool AddFKSlave(uchar slaveID){
             if(fkSlaveCount == MAX_FK_MASTER_TIME) // full
                 return false;
-            headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
+            pinHeader();
             uchar* slaves = header->fkSlave;
             // update slaves
             slaves[fkSlaveCount++] = slaveID;
@@ -463,7 +838,7 @@ class Table{
          * Remove foreign constraint slave
         */
         bool RemoveFKSlave(uchar slaveID){
-            headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
+            pinHeader();
             uchar* slaves = header->fkSlave;
             int pos = 0;
             while(pos < fkSlaveCount){
@@ -566,27 +941,63 @@ class Table{
         }
 
         /**
-         * Caution, this action writes back data not only in this table, but all the tables
+         * Write back all the pages of this table and give their frames back to bpm
+         * Dirty pages are sorted by page number and written in runs, see BufPageManager::flushFile
+         * Return false if some pages cannot be written, they are dropped anyway
         */
-        void WriteBack(){ 
+        bool WriteBack(){ 
             if(headerDirty){
-                headerBuf = bpm->reusePage(fid, 0, headerIdx, headerBuf);
-                header->ToString(headerBuf);
+                header->ToString(pinHeader());
                 bpm->markDirty(headerIdx);
-                bpm->writeBack(headerIdx); // marking dirty is not enough... write it back
-            }
-            else{ // ? Even header isn't dirty, we need to give it back to storage, or the copy in bpm may be outdated
-                // ? e.g. this table is closed and another table is opened. The new table has the same fid as previously opened one
-                // ? if headerIdx in bpm is not written back, the bpm will assume falsely that it has buffer for the header in the new table
-                int curPage, curFid;
-                bpm->getKey(headerIdx, curFid, curPage);
-                if(fid == curFid && curPage == 0)
-                    bpm->writeBack(headerIdx);
             }
-            while(!trackers.empty()){
-                WriteBackTracker(trackers.front());
-                trackers.pop();
+            // 先解除钉住, 否则flushFile只会写回而不会归还缓存页面
+            releaseGuards();
+            // ? Even clean pages must be given back, or the copy in bpm may be outdated
+            // ? e.g. this table is closed and another table is opened. The new table has the same fid as previously opened one
+            return bpm->flushFile(fid);
+        }
+
+        bool IsCompressed(){
+            return header->options & Header::Compressed;
+        }
+
+        bool IsSlotted(){
+            return header->options & Header::Slotted;
+        }
+
+        /**
+         * 按表头中的列和记录格式计算一页的槽位数, 一页放不下一条记录时返回0
+        */
+        static uint SlotNumOf(const Header* header){
+            if(!(header->options & Header::Slotted))
+                return PAGE_SIZE / header->recordLenth;
+            int colNum = 0;
+            while(colNum < MAX_COL_NUM && header->attrType[colNum] != DataType::NONE)
+                colNum++;
+            return SlottedPage::SlotNum(header->attrType, header->attrLenth, colNum);
+        }
+
+        /**
+         * 设置表的页面是否压缩后写入文件
+         * 文件中已有的页面都标记为脏页, 在WriteBack时按新的设置重新写一遍, 之后文件占用的空间就是压缩后的大小
+        */
+        bool SetCompression(bool on){
+            if(on)
+                header->options |= Header::Compressed;
+            else
+                header->options &= ~Header::Compressed;
+            headerDirty = true;
+            fm->setCompression(fid, on);
+            int pages = fm->pageCount(fid);
+            for(int i = 1; i < pages; i++){
+                int index;
+                if(bpm->getPage(fid, i, index) == nullptr){
+                    printf("In Table::SetCompression, cannot read page %d\n", i);
+                    return false;
+                }
+                bpm->markDirty(index);
             }
+            return true;
         }
 
         /**
@@ -598,13 +1009,48 @@ class Table{
                 return false;
             }
             int begin = RIDtoUint(&rid) + 1; // start from the next position
-            int nextRecordSlot = firstOneBitFrom(begin);
-            if(nextRecordSlot >= 0){
-                UintToRID(nextRecordSlot, &rid);
-                return true;
+            // 一次取出一页中所有有记录的槽位, 之后在其中查找, 不用每条记录都扫描位图
+            while(begin < (int)header->exploitedNum){
+                int page = begin / header->slotNum + START_PAGE;
+                if(page != slotsPage || slotsVersion != bitmapVersion){
+                    CollectSlots(page, 1, slotsCache);
+                    slotsPage = page;
+                    slotsVersion = bitmapVersion;
+                    slotsPos = 0;
+                }
+                if(slotsPos >= slotsCache.size() || slotsCache[slotsPos] < (uint)begin || (slotsPos > 0 && slotsCache[slotsPos - 1] >= (uint)begin))
+                    slotsPos = std::lower_bound(slotsCache.begin(), slotsCache.end(), (uint)begin) - slotsCache.begin();
+                if(slotsPos < slotsCache.size()){
+                    UintToRID(slotsCache[slotsPos++], &rid);
+                    return true;
+                }
+                begin = (page - START_PAGE + 1) * header->slotNum;
             }
-            else
+            return false;
+        }
+
+        /**
+         * 把第page页开始的pages个数据页中有记录的槽位号(见RIDtoUint)按顺序放入slots, 返回个数
+         * 每次扫描位图中的64位, 见BitScan.h
+        */
+        int CollectSlots(int page, int pages, std::vector<uint>& slots){
+            slots.clear();
+            if(page < START_PAGE){
+                printf("In Table::CollectSlots, trying to collect slots from header page or bitmap pages\n");
+                return 0;
+            }
+            int from = (page - START_PAGE) * header->slotNum;
+            int to = std::min((ll)from + (ll)pages * header->slotNum, (ll)header->exploitedNum);
+            if(from >= to)
+                return 0;
+            slots.resize(to - from);
+            int n = 0;
+            visitBitmap(from, to, [&slots, &n](const uchar* src, int begin, int end, int base){
+                n += bitScanCollect(src, begin, end, base, slots.data() + n);
                 return false;
+            });
+            slots.resize(n);
+            return n;
         }
 
         /**
@@ -719,18 +1165,19 @@ class Table{
             int colCount = wantedCols.size();
             for(auto it = wantedCols.begin(); it != wantedCols.end(); it++)
                 printTB[0].push_back(std::string((char*)header->attrName[*it], strnlen((char*)header->attrName[*it], MAX_ATTRI_NAME_LEN)));
-            Record tmpRec;
+            RecordView view;
             for(auto rid_it = selected.begin(); rid_it != selected.end(); rid_it++){
                 std::vector<std::string> tmpVec;
-                GetRecord(*rid_it, &tmpRec);
+                if(GetRecordView(*rid_it, &view) == nullptr)
+                    break;
                 for(auto field_it = wantedCols.begin(); field_it != wantedCols.end(); field_it++)
-                    tmpVec.push_back(Printer::FieldToStr(tmpRec, header->attrType[*field_it], *field_it, header->attrLenth[*field_it], offsets[*field_it]));
+                    tmpVec.push_back(Printer::FieldToStr(view.GetData(), header->attrType[*field_it], *field_it, header->attrLenth[*field_it], offsets[*field_it]));
                 printTB.push_back(std::move(tmpVec));
             }
             Printer::PrintTable(printTB, colCount, printTB.size());
         }
 
-        Scanner* GetScanner(bool (*demand)(const Record& record));
+        Scanner* GetScanner(bool (*demand)(const RecordView& record));
         Scanner* GetScanner(const uchar* right, int colNum, uchar* cmp);
 
         friend class DBMS;
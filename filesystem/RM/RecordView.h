@@ -0,0 +1,25 @@
+#ifndef RECORD_VIEW_H
+#define RECORD_VIEW_H
+#include "RID.h"
+#include "../utils/pagedef.h"
+class Table;
+/**
+ * 一条记录的只读视图, 由Table::GetRecordView得到
+ * data直接指向表钉住的数据页, 不复制记录, 也不分配内存, 可以按值复制
+ * 在下一次访问同一个表的数据页(GetRecord, GetRecordView, 插入和更新等)或者表写回之前有效
+ * 需要保留记录时用Record
+*/
+class RecordView{
+        const uchar* data = nullptr;
+        RID rid;
+    public:
+        const uchar* GetData()const{
+            return data;
+        }
+        const RID* GetRid()const{
+            return &rid;
+        }
+    friend class Table;
+};
+
+#endif // RECORD_VIEW_H
@@ -0,0 +1,239 @@
+#ifndef SLOTTED_PAGE_H
+#define SLOTTED_PAGE_H
+#include "DataType.h"
+#include "../utils/pagedef.h"
+#include <cstring>
+
+/**
+ * 变长记录的数据页(slotted page), 见Header::Slotted
+ * 页头8字节: 槽位目录的项数, 最低的记录的位置, 空闲字节数(包括记录之间的空洞), 保留
+ * 页头之后是槽位目录, 每项4字节: 记录在页中的位置和占用的字节数, 位置为0表示空槽位
+ * 记录从页尾向前存放, 目录向后增长, 中间是连续的空闲空间, 不够时先整理(Compact)
+ * 占用字节数的高两位是标记:
+ *   Forward: 记录已经搬到别的页, 这里只存放它现在的RID(页号和槽位号各4字节), 槽位号保持不变
+ *   Moved: 从别的页搬来的记录, 只能通过原来的槽位访问, 它的槽位在位图中不置位
+ * 新的页面全是0, 插入前由Init初始化, 没有初始化的页面目录为空
+ *
+ * 记录在页中按列紧凑存放(Encode): 空值位图照抄, CHAR和不超过255的VARCHAR去掉末尾的0, 前面加1字节长度
+ * 其它列(包括长varchar的RID)照抄. Decode还原成定长的记录, 上层看到的记录格式不变
+*/
+class SlottedPage{
+    public:
+        const static int HeaderLen = 8, EntryLen = 4;
+        // 每条记录至少占用这么多字节, 任何记录都能原地改成Forward
+        const static int MinTupleLen = 8;
+        const static ushort Forward = 0x8000, Moved = 0x4000, LenMask = 0x3fff;
+
+        static ushort& Count(uchar* page){
+            return ((ushort*)page)[0];
+        }
+        static ushort& DataStart(uchar* page){
+            return ((ushort*)page)[1];
+        }
+        static ushort& FreeBytes(uchar* page){
+            return ((ushort*)page)[2];
+        }
+        static ushort* Entry(uchar* page, int slot){
+            return (ushort*)(page + HeaderLen + slot * EntryLen);
+        }
+        // 第slot个槽位有记录(包括Forward和Moved)
+        static bool Used(uchar* page, int slot){
+            return slot < Count(page) && Entry(page, slot)[0] != 0;
+        }
+        static ushort Flags(uchar* page, int slot){
+            return Entry(page, slot)[1] & ~LenMask;
+        }
+        static int Size(uchar* page, int slot){
+            return Entry(page, slot)[1] & LenMask;
+        }
+        static uchar* Data(uchar* page, int slot){
+            return page + Entry(page, slot)[0];
+        }
+        static int AllocLen(int len){
+            return len > MinTupleLen ? len : MinTupleLen;
+        }
+
+        static void Init(uchar* page){
+            if(DataStart(page) != 0)
+                return;
+            Count(page) = 0;
+            DataStart(page) = PAGE_SIZE;
+            FreeBytes(page) = PAGE_SIZE - HeaderLen;
+        }
+
+        /**
+         * 返回一个空槽位, 目录中没有空项时在末尾加一项, 目录已经有maxSlots项时返回-1
+        */
+        static int FindSlot(uchar* page, int maxSlots){
+            int count = Count(page);
+            for(int i = 0; i < count; i++)
+                if(Entry(page, i)[0] == 0)
+                    return i;
+            return count < maxSlots ? count : -1;
+        }
+
+        /**
+         * 页面能否放下一条len字节的新记录
+        */
+        static bool Fits(uchar* page, int len, int maxSlots){
+            int slot = FindSlot(page, maxSlots);
+            if(slot < 0)
+                return false;
+            int need = AllocLen(len) + (slot == Count(page) ? EntryLen : 0);
+            return FreeBytes(page) >= need;
+        }
+
+        /**
+         * 把所有记录移到页尾连续存放, 槽位号和记录的内容不变
+        */
+        static void Compact(uchar* page){
+            uchar copy[PAGE_SIZE];
+            memcpy(copy, page, PAGE_SIZE);
+            int end = PAGE_SIZE, count = Count(page);
+            for(int i = 0; i < count; i++){
+                ushort* entry = Entry(page, i);
+                if(entry[0] == 0)
+                    continue;
+                int size = entry[1] & LenMask;
+                end -= size;
+                memcpy(page + end, copy + entry[0], size);
+                entry[0] = end;
+            }
+            DataStart(page) = end;
+        }
+
+        /**
+         * 给槽位slot(FindSlot的返回值或者已经用Release腾空的槽位)分配len字节, 返回记录的位置
+         * 调用前要确认放得下
+        */
+        static uchar* Alloc(uchar* page, int slot, int len, ushort flags){
+            if(slot == Count(page)){
+                Count(page)++;
+                FreeBytes(page) -= EntryLen;
+                Entry(page, slot)[0] = 0;
+            }
+            int size = AllocLen(len);
+            int dirEnd = HeaderLen + Count(page) * EntryLen;
+            if(DataStart(page) - dirEnd < size)
+                Compact(page);
+            DataStart(page) -= size;
+            FreeBytes(page) -= size;
+            ushort* entry = Entry(page, slot);
+            entry[0] = DataStart(page);
+            entry[1] = size | flags;
+            return page + entry[0];
+        }
+
+        /**
+         * 释放槽位slot占用的空间, 槽位仍然在目录中, 之后可以用Alloc重新分配
+        */
+        static void Release(uchar* page, int slot){
+            ushort* entry = Entry(page, slot);
+            FreeBytes(page) += entry[1] & LenMask;
+            entry[0] = entry[1] = 0;
+        }
+
+        /**
+         * 删除槽位slot的记录, 目录末尾的空项一起去掉
+        */
+        static void Free(uchar* page, int slot){
+            Release(page, slot);
+            while(Count(page) > 0 && Entry(page, Count(page) - 1)[0] == 0){
+                Count(page)--;
+                FreeBytes(page) += EntryLen;
+            }
+            if(Count(page) == 0)
+                DataStart(page) = PAGE_SIZE;
+        }
+
+        /**
+         * 记录原地缩短为len字节, 多出来的空间成为空洞, 整理时收回
+        */
+        static void Shrink(uchar* page, int slot, int len, ushort flags){
+            ushort* entry = Entry(page, slot);
+            int size = AllocLen(len);
+            FreeBytes(page) += (entry[1] & LenMask) - size;
+            entry[1] = size | flags;
+        }
+
+        /**
+         * 长度不超过255的字符串列去掉末尾的0存放
+        */
+        static bool Trimmed(uchar type, ushort length){
+            return type == DataType::CHAR || (type == DataType::VARCHAR && length <= 255);
+        }
+
+        /**
+         * 编码后最长和最短的字节数
+        */
+        static int MaxLen(const uchar* types, const ushort* lengths, int colNum){
+            int ans = 4;
+            for(int i = 0; i < colNum; i++)
+                ans += DataType::lengthOf(types[i], lengths[i]) + (Trimmed(types[i], lengths[i]) ? 1 : 0);
+            return ans;
+        }
+        static int MinLen(const uchar* types, const ushort* lengths, int colNum){
+            int ans = 4;
+            for(int i = 0; i < colNum; i++)
+                ans += Trimmed(types[i], lengths[i]) ? 1 : DataType::lengthOf(types[i], lengths[i]);
+            return ans;
+        }
+
+        /**
+         * 把定长记录src编码到dst, 返回编码后的字节数
+        */
+        static int Encode(const uchar* types, const ushort* lengths, int colNum, const uchar* src, uchar* dst){
+            memcpy(dst, src, 4);
+            int from = 4, to = 4;
+            for(int i = 0; i < colNum; i++){
+                int width = DataType::lengthOf(types[i], lengths[i]);
+                if(Trimmed(types[i], lengths[i])){
+                    int len = width;
+                    while(len > 0 && src[from + len - 1] == 0)
+                        len--;
+                    dst[to++] = len;
+                    memcpy(dst + to, src + from, len);
+                    to += len;
+                }
+                else{
+                    memcpy(dst + to, src + from, width);
+                    to += width;
+                }
+                from += width;
+            }
+            return to;
+        }
+
+        /**
+         * 把Encode的结果还原成recordLenth字节的定长记录
+        */
+        static void Decode(const uchar* types, const ushort* lengths, int colNum, const uchar* src, uchar* dst, int recordLenth){
+            memset(dst, 0, recordLenth);
+            memcpy(dst, src, 4);
+            int from = 4, to = 4;
+            for(int i = 0; i < colNum; i++){
+                int width = DataType::lengthOf(types[i], lengths[i]);
+                if(Trimmed(types[i], lengths[i])){
+                    int len = src[from++];
+                    memcpy(dst + to, src + from, len);
+                    from += len;
+                }
+                else{
+                    memcpy(dst + to, src + from, width);
+                    from += width;
+                }
+                to += width;
+            }
+        }
+
+        /**
+         * 一页最多能有的槽位数, 即全部是最短的记录时的条数. 最长的记录一页放不下时返回0
+        */
+        static uint SlotNum(const uchar* types, const ushort* lengths, int colNum){
+            if(MaxLen(types, lengths, colNum) > PAGE_SIZE - HeaderLen - EntryLen)
+                return 0;
+            return (PAGE_SIZE - HeaderLen) / (AllocLen(MinLen(types, lengths, colNum)) + EntryLen);
+        }
+};
+
+#endif // SLOTTED_PAGE_H
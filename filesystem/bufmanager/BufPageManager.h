@@ -1,201 +1,1784 @@
-#ifndef BUF_PAGE_MANAGER
-#define BUF_PAGE_MANAGER
-#include "../utils/MyHashMap.h"
-#include "../utils/MyBitMap.h"
-#include "FindReplace.h"
-#include "../utils/pagedef.h"
-#include "../fileio/FileManager.h"
-#include "../utils/MyLinkList.h"
-/*
- * BufPageManager
- * 实现了一个缓存的管理器
- */
-struct BufPageManager {
-private:
-	int last;
-	FileManager* fileManager;
-	MyHashMap* hash;
-	FindReplace* replace;
-	//MyLinkList* bpl;
-	bool* dirty;
-	/*
-	 * 缓存页面数组
-	 */
-	BufType* addr;
-	BufType allocMem() {
-		return new unsigned int[(PAGE_SIZE >> 2)];
-	}
-	BufType fetchPage(int typeID, int pageID, int& index) {
-		BufType b;
-		index = replace->find();
-		b = addr[index];
-		if (b == NULL) {
-			b = allocMem();
-			addr[index] = b;
-		} else {
-			if (dirty[index]) {
-				int k1, k2;
-				hash->getKeys(index, k1, k2);
-				fileManager->writePage(k1, k2, b, 0);
-				dirty[index] = false;
-			}
-		}
-		hash->replace(index, typeID, pageID);
-		return b;
-	}
-	static BufPageManager *instance;
-	
-	/*
-	 * 构造函数
-	 * @参数fm:文件管理器，缓存管理器需要利用文件管理器与磁盘进行交互
-	 */
-	BufPageManager(FileManager* fm) {
-		int c = CAP;
-		int m = MOD;
-		last = -1;
-		fileManager = fm;
-		//bpl = new MyLinkList(CAP, MAX_FILE_NUM);
-		dirty = new bool[CAP];
-		addr = new BufType[CAP];
-		hash = new MyHashMap(c, m);
-	    replace = new FindReplace(c);
-		for (int i = 0; i < CAP; ++ i) {
-			dirty[i] = false;
-			addr[i] = NULL;
-		}
-	}
-public:
-	/*
-	 * @函数名allocPage
-	 * @参数fileID:文件id，数据库程序在运行时，用文件id来区分正在打开的不同的文件
-	 * @参数pageID:文件页号，表示在fileID指定的文件中，第几个文件页
-	 * @参数index:函数返回时，用来记录缓存页面数组中的下标
-	 * @参数ifRead:是否要将文件页中的内容读到缓存中
-	 * 返回:缓存页面的首地址
-	 * 功能:为文件中的某一个页面获取一个缓存中的页面
-	 *           缓存中的页面在缓存页面数组中的下标记录在index中
-	 *           并根据ifRead是否为true决定是否将文件中的内容写到获取的缓存页面中
-	 * 注意:在调用函数allocPage之前，调用者必须确信(fileID,pageID)指定的文件页面不存在缓存中
-	 *           如果确信指定的文件页面不在缓存中，那么就不用在hash表中进行查找，直接调用替换算法，节省时间
-	 */
-	BufType allocPage(int fileID, int pageID, int& index, bool ifRead = false) {
-		BufType b = fetchPage(fileID, pageID, index);
-		if (ifRead) {
-			fileManager->readPage(fileID, pageID, b, 0);
-		}
-		return b;
-	}
-	/*
-	 * @函数名getPage
-	 * @参数fileID:文件id
-	 * @参数pageID:文件页号
-	 * @参数index:函数返回时，用来记录缓存页面数组中的下标
-	 * 返回:缓存页面的首地址
-	 * 功能:为文件中的某一个页面在缓存中找到对应的缓存页面
-	 *           文件页面由(fileID,pageID)指定
-	 *           缓存中的页面在缓存页面数组中的下标记录在index中
-	 *           首先，在hash表中查找(fileID,pageID)对应的缓存页面，
-	 *           如果能找到，那么表示文件页面在缓存中
-	 *           如果没有找到，那么就利用替换算法获取一个页面
-	 */
-	BufType getPage(int fileID, int pageID, int& index) {
-		index = hash->findIndex(fileID, pageID);
-		if (index != -1) {
-			access(index);
-			return addr[index];
-		} else {
-			BufType b = fetchPage(fileID, pageID, index);
-			fileManager->readPage(fileID, pageID, b, 0);
-			return b;
-		}
-	}
-	/**
-	 * Similar to getPage, except that you have a suspect for index
-	 * Faster than getPage sometimes and won't be noticably slower than it in any occasion
-	 * Use uchar* instead of uint* for argument and return value
-	*/
-	uchar* reusePage(int fileID, int pageID, int& index, uchar* buf){
-		if(buf == nullptr)
-			return (uchar*)getPage(fileID, pageID, index);
-		int tmpFID, tmpPID;
-		getKey(index, tmpFID, tmpPID);
-		if(tmpFID == fileID && tmpPID == pageID){
-			access(index);
-			return buf;
-		}
-		else
-			return (uchar*)getPage(fileID, pageID, index);
-	}
-	/*
-	 * @函数名access
-	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
-	 * 功能:标记index代表的缓存页面被访问过，为替换算法提供信息
-	 */
-	void access(int index) {
-		if (index == last) {
-			return;
-		}
-		replace->access(index);
-		last = index;
-	}
-	/*
-	 * @函数名markDirty
-	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
-	 * 功能:标记index代表的缓存页面被写过，保证替换算法在执行时能进行必要的写回操作，
-	 *           保证数据的正确性
-	 */
-	void markDirty(int index) {
-		dirty[index] = true;
-		access(index);
-	}
-	/*
-	 * @函数名release
-	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
-	 * 功能:将index代表的缓存页面归还给缓存管理器，在归还前，缓存页面中的数据不标记写回
-	 */
-	void release(int index) {
-		dirty[index] = false;
-		replace->free(index);
-		hash->remove(index);
-	}
-	/*
-	 * @函数名writeBack
-	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
-	 * 功能:将index代表的缓存页面归还给缓存管理器，在归还前，缓存页面中的数据需要根据脏页标记决定是否写到对应的文件页面中
-	 */
-	void writeBack(int index) {
-		if (dirty[index]) {
-			int f, p;
-			hash->getKeys(index, f, p);
-			fileManager->writePage(f, p, addr[index], 0);
-			dirty[index] = false;
-		}
-		replace->free(index);
-		hash->remove(index);
-	}
-	/*
-	 * @函数名close
-	 * 功能:将所有缓存页面归还给缓存管理器，归还前需要根据脏页标记决定是否写到对应的文件页面中
-	 */
-	void close() {
-		for (int i = 0; i < CAP; ++ i) {
-			writeBack(i);
-		}
-	}
-	/*
-	 * @函数名getKey
-	 * @参数index:缓存页面数组中的下标，用来指定一个缓存页面
-	 * @参数fileID:函数返回时，用于存储指定缓存页面所属的文件号
-	 * @参数pageID:函数返回时，用于存储指定缓存页面对应的文件页号
-	 */
-	void getKey(int index, int& fileID, int& pageID) {
-		hash->getKeys(index, fileID, pageID);
-	}
-	
-	static BufPageManager* Instance(){
-		if(instance == nullptr)
-			instance = new BufPageManager(FileManager::Instance());
-		return instance;
-	}
-};
-#endif
+#ifndef BUF_PAGE_MANAGER
+#define BUF_PAGE_MANAGER
+#include "../utils/PageTable.h"
+#include "../utils/MyBitMap.h"
+#include "FindReplace.h"
+#include "TwoQReplace.h"
+#include "../utils/pagedef.h"
+#include "../fileio/FileManager.h"
+#include "../log/LogManager.h"
+#include "../utils/MyLinkList.h"
+#include <cassert>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include <algorithm>
+#include <deque>
+#include <cstring>
+#include <cstdlib>
+#include <sys/mman.h>
+/*
+ * BufStats
+ * 缓存的统计信息，BufPageManager为每个分片的每个fileID各维护一份，由分片的latch保护
+ * fileID在文件关闭后会被复用，因此按fileID统计的数字是这个fileID上所有文件的累计
+ */
+struct BufStats {
+	// 请求的页面已在缓存中/不在缓存中
+	ull hits;
+	ull misses;
+	// 页面被替换出缓存，其中dirtyEvictions个在替换时是脏页，需要同步写回
+	ull evictions;
+	ull dirtyEvictions;
+	// 替换之外的写回，包括后台线程、writeBack、flushFile和close
+	ull writeBacks;
+	// 预读线程读入的页面
+	ull prefetches;
+	ull readBytes;
+	ull writeBytes;
+	// 读写失败的页面数，其中corruptPages个是读出后校验和不对
+	ull ioErrors;
+	ull corruptPages;
+	// 直接从只读映射中访问的页面，这些访问不经过缓存，不计入hits和misses
+	ull mappedReads;
+	// 以下两项不是计数器，由getStats在统计时扫描缓存得到
+	int resident;
+	int dirtyPages;
+	BufStats() {
+		memset(this, 0, sizeof(BufStats));
+	}
+	void add(const BufStats& other) {
+		hits += other.hits;
+		misses += other.misses;
+		evictions += other.evictions;
+		dirtyEvictions += other.dirtyEvictions;
+		writeBacks += other.writeBacks;
+		prefetches += other.prefetches;
+		readBytes += other.readBytes;
+		writeBytes += other.writeBytes;
+		ioErrors += other.ioErrors;
+		corruptPages += other.corruptPages;
+		mappedReads += other.mappedReads;
+		resident += other.resident;
+		dirtyPages += other.dirtyPages;
+	}
+	double hitRatio() const {
+		return hits + misses == 0 ? 0 : (double)hits / (hits + misses);
+	}
+};
+/*
+ * BufPageManager
+ * 实现了一个缓存的管理器
+ * 缓存被分为BUF_SHARD_NUM个分片，每个分片有自己的锁，可以被多个线程同时使用
+ * 可选的后台线程定期写回脏页，使替换时不需要同步写回
+ * 可选的预读线程在发现顺序访问时提前读入之后的页面
+ * 设置了日志(setLog)时，写日志的文件的修改先写日志，页面写回前日志必须已经落盘
+ */
+struct BufPageManager {
+private:
+	/*
+	 * BufRing
+	 * 一个文件在一个分片中的环形缓冲区，由分片的latch保护
+	 * frames[i]是环中第i个位置的缓存页面下标，pages[i]是环放进去的页号，-1表示这个位置还没有页面
+	 * 如果页面已经不是环放进去的那一页，说明它被共享缓存拿走了，这个位置要重新找一个页面
+	 */
+	struct BufRing {
+		int* frames;
+		int* pages;
+		int pos;
+	};
+	/*
+	 * BufShard
+	 * 缓存的一个分片，管理缓存页面数组中[base, base + shardCap)的页面
+	 * 文件页面(fileID,pageID)由shardOf决定属于哪个分片
+	 * 分片内的hash表和替换算法使用分片内的下标，它们以及分片内页面的dirty、pinCount都由latch保护
+	 * 任何时候最多只持有一个分片的latch
+	 */
+	struct BufShard {
+		std::mutex latch;
+		PageTable* hash;
+		Replacer* replace;
+		int base;
+		int last;
+		int dirtyNum;
+		// 脏页比例过高时，后台线程从这里开始继续扫描分片内的页面
+		int flushCursor;
+		// 分片内每有一个脏页被写回(或丢弃)就加一，预读线程据此判断它读到的内容是否已经过时
+		ull writeSeq;
+		// 分片内按fileID的统计，下标为fileID
+		BufStats* stats;
+		// 正在进行批量操作的文件的环形缓冲区，下标为fileID，其他文件为nullptr
+		BufRing** rings;
+	};
+	/*
+	 * 每个文件的顺序访问检测状态
+	 * 只用于启发式判断，多个线程同时更新时出错也没有关系
+	 */
+	struct ReadAheadState {
+		std::atomic<int> lastPage;
+		std::atomic<int> runLength;
+		// 已经请求预读到的页号
+		std::atomic<int> aheadTo;
+	};
+	/*
+	 * 一次批量写回中的一个页面，见writeItems
+	 */
+	struct FlushItem {
+		int fileID;
+		int pageID;
+		int index;
+		bool failed;
+		// 写回前日志需要落盘到的位置
+		ull lsn;
+		// 收集时页面的recLSN，写回失败时恢复
+		ull recLSN;
+		// 不为nullptr时写回的是这份副本(shadow或被钉住的页面)，而不是页面本身，见collectLocked和collectShadowLocked
+		BufType copy;
+		bool operator<(const FlushItem& other) const {
+			return fileID < other.fileID || (fileID == other.fileID && pageID < other.pageID);
+		}
+	};
+	int frameNum;
+	int shardCap;
+	BufShard* shards;
+	FileManager* fileManager;
+	//MyLinkList* bpl;
+	bool* dirty;
+	/*
+	 * 每个缓存页面被钉住的次数，大于0时替换算法不会选中它
+	 */
+	int* pinCount;
+	/*
+	 * 正在被后台线程写回的页面，不能被替换或归还
+	 */
+	bool* flushing;
+	/*
+	 * 后台写回线程
+	 * flushLatch在一轮写回的全过程中被持有，flushFile也需要它，因此关闭文件时不会有针对该文件的写回正在进行
+	 * 加锁顺序: flushLatch在分片的latch之前
+	 */
+	std::thread flusher;
+	std::mutex flushLatch;
+	std::mutex flusherMutex;
+	std::condition_variable flusherCond;
+	bool flusherRunning;
+	std::atomic<int> maxDirtyPercent;
+	std::atomic<int> flushInterval;
+	int* flushCandidates;
+	/*
+	 * 预读线程
+	 * prefetchLatch在处理一批预读请求的全过程中被持有，flushFile也需要它，因此文件关闭后不会再被预读
+	 * 加锁顺序: flushLatch, prefetchLatch, prefetchMutex或分片的latch
+	 */
+	std::thread prefetcher;
+	std::mutex prefetchLatch;
+	std::mutex prefetchMutex;
+	std::condition_variable prefetchCond;
+	std::atomic<bool> prefetcherRunning;
+	std::deque<std::pair<int, int>> prefetchQueue;
+	ReadAheadState readAhead[MAX_FILE_NUM];
+	// 每个文件从只读映射中访问的页面数，不经过分片，因此不由分片的latch保护
+	std::atomic<ull> mappedReads[MAX_FILE_NUM];
+	// 一批预读的页面先读到这里，BUF_PREFETCH_BATCH个
+	BufType* prefetchBufs;
+	/*
+	 * 批量读写的AsyncIO，writeIO由flushLatch保护，readIO由prefetchLatch保护
+	 */
+	AsyncIO* writeIO;
+	AsyncIO* readIO;
+	/*
+	 * 批量操作
+	 * bulkRefs[fileID]是fileID上正在进行的批量操作个数，由bulkLatch保护
+	 * 加锁顺序: bulkLatch在分片的latch之前
+	 */
+	std::mutex bulkLatch;
+	int bulkRefs[MAX_FILE_NUM];
+	// 每个分片中一个环形缓冲区的页面个数
+	int ringCap;
+	/*
+	 * 缓存页面数组，所有页面位于同一块内存arena中，addr[i] = arena + i * PAGE_SIZE
+	 * arena按BUF_ARENA_ALIGN对齐，每个页面都满足O_DIRECT的对齐要求，读写时不需要复制
+	 */
+	BufType* addr;
+	uchar* arena;
+	size_t arenaSize;
+	bool hugePages;
+	/*
+	 * 预写日志，log为nullptr时不写日志
+	 * 写日志的文件的页面被钉住期间，shadow[index]保存它上一次写日志时的内容，比较两者得到修改过的字节范围，见logDiffLocked
+	 * 页面只在被钉住时修改，因此没有被钉住的页面总是和日志一致，可以随时写回
+	 * pageLSN[index]是修改这个页面的最后一组日志记录的END的位置，页面写回之前日志必须落盘到这里
+	 * recLSN[index]是页面上次写回之后第一条修改它的日志记录开始的位置，为0时页面上没有已经写日志但还没有写回的修改
+	 *           所有页面的recLSN的最小值之前的日志在恢复时不再需要，见检查点
+	 * shadowOpen[index]为true时shadow中有还没有结束的组的修改，它不能代替页面写回
+	 * 写日志的文件只能由一个线程修改，组(beginGroup/endGroup)、shadowFrames和groupHeld由这个线程使用
+	 * shadowFrames和groupHeld由logLatch保护，加锁顺序: 分片的latch在logLatch之前
+	 */
+	LogManager* log;
+	ull* pageLSN;
+	ull* recLSN;
+	uchar** shadow;
+	bool* shadowOpen;
+	std::mutex logLatch;
+	// 有shadow的页面
+	std::vector<int> shadowFrames;
+	// 在组中最后一次解除钉住的修改过的页面，由组钉住到endGroup
+	std::vector<int> groupHeld;
+	std::atomic<int> groupDepth;
+	// 最外层的组开始时日志的位置
+	ull groupStart;
+	/*
+	 * 模糊检查点，由后台写回线程进行
+	 * 日志增长到一定大小或者经过一定时间后，记下当时的日志位置checkpointTarget，之后每轮写回也写回recLSN在它之前的页面
+	 * 这样的页面都写回后(被钉住的除外)，所有页面的recLSN的最小值就是恢复开始的位置，交给LogManager::Checkpoint
+	 * checkpointLatch在一轮写回和LogManager::Checkpoint的全过程中被持有，setLog也需要它，因此更换日志时没有检查点在进行
+	 * 加锁顺序: checkpointLatch在flushLatch之前
+	 */
+	std::mutex checkpointLatch;
+	ull checkpointTarget;
+	// 上一次检查点开始时的日志位置和时间
+	ull checkpointStart;
+	std::chrono::steady_clock::time_point checkpointTime;
+	/*
+	 * 缓存页面数组之外的页面大小的内存，比如预读的临时缓存，按FILE_DIRECT_ALIGN对齐，使用O_DIRECT时可以直接读写
+	 */
+	BufType allocMem() {
+		void* p;
+		if (posix_memalign(&p, FILE_DIRECT_ALIGN, PAGE_SIZE) != 0) {
+			printf("In BufPageManager, cannot allocate a page\n");
+			assert(false);
+		}
+		return (BufType)p;
+	}
+	/*
+	 * 同一文件的连续页面分散到不同分片，并行扫描不会集中在一个latch上
+	 */
+	BufShard& shardOf(int fileID, int pageID) {
+		uint h = (uint)fileID * 0x9e3779b1u ^ (uint)pageID * 0x85ebca77u;
+		h ^= h >> 15;
+		return shards[h % BUF_SHARD_NUM];
+	}
+	BufShard& shardOf(int index) {
+		return shards[index / shardCap];
+	}
+	/*
+	 * 以下带Locked后缀的函数要求调用者已经持有分片s的latch
+	 */
+	int dirtyLimit() {
+		return shardCap * maxDirtyPercent / 100;
+	}
+	void setDirtyLocked(BufShard& s, int index, bool d) {
+		if (dirty[index] != d) {
+			dirty[index] = d;
+			s.dirtyNum += d ? 1 : -1;
+			if (!d) {
+				++ s.writeSeq;
+			}
+		}
+	}
+	/*
+	 * 从文件的环形缓冲区中取下一个位置，返回可以直接复用的分片内下标
+	 * 位置为空、页面已被共享缓存拿走、或者页面被钉住或正在写回时返回-1，调用者用替换算法找一个页面填入slot
+	 * 环形缓冲区的位置在fetchPageLocked成功取得页面后才前进
+	 */
+	int ringNextLocked(BufShard& s, BufRing& ring, int fileID, int& slot) {
+		slot = ring.pos;
+		int index = ring.frames[slot];
+		if (index == -1 || pinCount[index] > 0 || flushing[index]) {
+			return -1;
+		}
+		int f, p;
+		s.hash->getKeys(index - s.base, f, p);
+		if (f != fileID || p != ring.pages[slot]) {
+			return -1;
+		}
+		return index - s.base;
+	}
+	/*
+	 * 如果fileID被映射到内存中，返回页面在映射中的地址，index置为BUF_MAPPED_INDEX，否则返回nullptr
+	 */
+	BufType mappedPage(int fileID, int pageID, int& index) {
+		BufType b = fileManager->mappedPage(fileID, pageID);
+		if (b == nullptr) {
+			return nullptr;
+		}
+		index = BUF_MAPPED_INDEX;
+		mappedReads[fileID].fetch_add(1, std::memory_order_relaxed);
+		noteAccess(fileID, pageID, true);
+		return b;
+	}
+	/*
+	 * 写回页面index之前调用，保证修改它的日志记录已经落盘
+	 */
+	bool flushLogFor(int index) {
+		return log == nullptr || pageLSN[index] == 0 || log->FlushTo(pageLSN[index]);
+	}
+	/*
+	 * 比较页面index和它的shadow，把修改过的字节范围写成LOG_UPDATE记录并更新shadow
+	 * 按8字节比较，相距不超过LOG_DIFF_GAP字节的两段修改合并为一条记录
+	 * 返回页面是否被修改过，修改过的页面同时被标记为脏页
+	 */
+	bool logDiffLocked(BufShard& s, int index) {
+		const ull* cur = (const ull*)addr[index];
+		ull* old = (ull*)shadow[index];
+		const int words = PAGE_SIZE / 8, gap = LOG_DIFF_GAP / 8;
+		int f = -1, p = -1;
+		bool changed = false;
+		ull start = log->CurrentLSN();
+		for (int i = 0; i < words; ) {
+			// 先按64字节跳过没有修改的部分
+			if ((i & 7) == 0 && memcmp(cur + i, old + i, 64) == 0) {
+				i += 8;
+				continue;
+			}
+			if (cur[i] == old[i]) {
+				++ i;
+				continue;
+			}
+			int end = i + 1;
+			for (int j = end; j < words && j - end < gap; ++ j) {
+				if (cur[j] != old[j]) {
+					end = j + 1;
+				}
+			}
+			if (f == -1) {
+				s.hash->getKeys(index - s.base, f, p);
+			}
+			log->LogUpdate(f, p, i * 8, (end - i) * 8, cur + i);
+			memcpy(old + i, cur + i, (end - i) * 8);
+			changed = true;
+			i = end;
+		}
+		if (changed) {
+			setDirtyLocked(s, index, true);
+			if (recLSN[index] == 0) {
+				recLSN[index] = start;
+			}
+			if (groupDepth > 0) {
+				shadowOpen[index] = true;
+			}
+		}
+		return changed;
+	}
+	/*
+	 * 页面被第一次钉住时调用，如果它属于写日志的文件，保存它现在的内容
+	 */
+	void shadowLocked(BufShard& s, int index) {
+		int f, p;
+		s.hash->getKeys(index - s.base, f, p);
+		if (f == -1 || !log->IsAttached(f)) {
+			return;
+		}
+		shadow[index] = (uchar*)allocMem();
+		memcpy(shadow[index], addr[index], PAGE_SIZE);
+		std::lock_guard<std::mutex> lock(logLatch);
+		shadowFrames.push_back(index);
+	}
+	void dropShadowLocked(int index) {
+		free(shadow[index]);
+		shadow[index] = nullptr;
+		shadowOpen[index] = false;
+		std::lock_guard<std::mutex> lock(logLatch);
+		for (size_t i = 0; i < shadowFrames.size(); ++ i) {
+			if (shadowFrames[i] == index) {
+				shadowFrames[i] = shadowFrames.back();
+				shadowFrames.pop_back();
+				break;
+			}
+		}
+	}
+	/*
+	 * 有shadow的页面最后一次解除钉住之前调用，把还没有写日志的修改写成日志并释放shadow
+	 * 在组中且页面有修改时，页面改由组钉住，返回false，endGroup时再解除钉住，保证组结束之前它不会被写回
+	 */
+	bool releaseShadowLocked(BufShard& s, int index) {
+		bool changed = logDiffLocked(s, index);
+		if (changed && groupDepth > 0) {
+			std::lock_guard<std::mutex> lock(logLatch);
+			groupHeld.push_back(index);
+			return false;
+		}
+		if (changed) {
+			pageLSN[index] = log->LogEnd();
+		}
+		dropShadowLocked(index);
+		return true;
+	}
+	BufType fetchPageLocked(BufShard& s, int typeID, int pageID, int& index) {
+		BufType b;
+		// 批量操作中的文件先复用自己环形缓冲区中的页面，不去替换共享缓存中的页面
+		BufRing* ring = s.rings[typeID];
+		int slot = -1;
+		int local = ring != nullptr ? ringNextLocked(s, *ring, typeID, slot) : -1;
+		bool recycled = local != -1;
+		if (!recycled) {
+			// 正在被后台线程写回的页面不能替换，跳过它们
+			local = s.replace->find(flushing + s.base);
+		}
+		if (local == -1) {
+			// 缓存耗尽不是致命错误，调用者按读写出错处理，等页面被归还后可以重试
+			printf("In BufPageManager::fetchPage, buffer pool exhausted: all %d frames of the shard are pinned or being flushed\n", shardCap);
+			index = -1;
+			return nullptr;
+		}
+		index = s.base + local;
+		b = addr[index];
+		int k1, k2;
+		s.hash->getKeys(local, k1, k2);
+		if (dirty[index]) {
+			// 写回失败时页面保持原样，仍然是脏的，替换算法和环形缓冲区的状态还没有改变
+			if (!flushLogFor(index) || fileManager->writePage(k1, k2, b, 0) != 0) {
+				++ s.stats[k1].ioErrors;
+				index = -1;
+				return nullptr;
+			}
+			++ s.stats[k1].dirtyEvictions;
+			s.stats[k1].writeBytes += PAGE_SIZE;
+			setDirtyLocked(s, index, false);
+		}
+		if (k1 != -1) {
+			++ s.stats[k1].evictions;
+		}
+		pageLSN[index] = recLSN[index] = 0;
+		s.hash->replace(local, typeID, pageID);
+		if (recycled) {
+			s.replace->recycle(local, typeID, pageID);
+		} else {
+			s.replace->load(local, typeID, pageID);
+		}
+		if (ring != nullptr) {
+			ring->frames[slot] = index;
+			ring->pages[slot] = pageID;
+			ring->pos = (slot + 1) % ringCap;
+		}
+		return b;
+	}
+	BufType getPageLocked(BufShard& s, int fileID, int pageID, int& index) {
+		int local = s.hash->findIndex(fileID, pageID);
+		if (local != -1) {
+			index = s.base + local;
+			++ s.stats[fileID].hits;
+			accessLocked(s, index);
+			return addr[index];
+		} else {
+			BufType b = fetchPageLocked(s, fileID, pageID, index);
+			if (b == nullptr) {
+				return nullptr;
+			}
+			++ s.stats[fileID].misses;
+			if (!readLocked(s, fileID, pageID, index)) {
+				return nullptr;
+			}
+			return b;
+		}
+	}
+	/*
+	 * 把(fileID,pageID)读入刚由fetchPageLocked得到的页面index
+	 * 读失败时归还页面，index置为-1，返回false
+	 */
+	bool readLocked(BufShard& s, int fileID, int pageID, int& index) {
+		int ret = fileManager->readPage(fileID, pageID, addr[index], 0);
+		if (ret != 0) {
+			++ s.stats[fileID].ioErrors;
+			if (ret == FILE_PAGE_CORRUPT) {
+				++ s.stats[fileID].corruptPages;
+			}
+			s.replace->free(index - s.base);
+			s.hash->remove(index - s.base);
+			index = -1;
+			return false;
+		}
+		s.stats[fileID].readBytes += PAGE_SIZE;
+		return true;
+	}
+	void accessLocked(BufShard& s, int index) {
+		if (index == s.last || pinCount[index] > 0) {
+			return;
+		}
+		s.replace->access(index - s.base);
+		s.last = index;
+	}
+	void pinLocked(BufShard& s, int index) {
+		if (pinCount[index]++ == 0) {
+			s.replace->pin(index - s.base);
+			if (log != nullptr && shadow[index] == nullptr) {
+				shadowLocked(s, index);
+			}
+		}
+	}
+	/*
+	 * 写回页面并归还，被钉住或正在写回的页面只写回
+	 * 写回失败时，dropOnError为false则页面保持原样；为true则仍然归还，页面上的修改丢失
+	 * 文件即将关闭时必须归还，否则fileID被复用后新文件会读到这个页面
+	 * 被钉住的写日志的页面先把修改写成日志，在组中时不写回，等组结束后再写
+	 * 返回写回是否成功
+	 */
+	bool writeBackLocked(BufShard& s, int index, bool dropOnError = false) {
+		int local = index - s.base;
+		bool ok = true;
+		if (shadow[index] != nullptr) {
+			if (groupDepth > 0) {
+				return true;
+			}
+			if (logDiffLocked(s, index)) {
+				pageLSN[index] = log->LogEnd();
+			}
+		}
+		if (dirty[index]) {
+			int f, p;
+			s.hash->getKeys(local, f, p);
+			if (!flushLogFor(index) || fileManager->writePage(f, p, addr[index], 0) != 0) {
+				++ s.stats[f].ioErrors;
+				ok = false;
+				if (!dropOnError) {
+					return false;
+				}
+				printf("In BufPageManager::writeBack, page %d of file %d is dropped\n", p, f);
+			} else {
+				++ s.stats[f].writeBacks;
+				s.stats[f].writeBytes += PAGE_SIZE;
+			}
+			setDirtyLocked(s, index, false);
+			recLSN[index] = 0;
+		}
+		if (pinCount[index] > 0 || flushing[index]) {
+			return ok;
+		}
+		s.replace->free(local);
+		s.hash->remove(local);
+		return ok;
+	}
+	/*
+	 * 如果页面是脏的，把它加入items，标记为干净并开始写回，返回加入的页面数(0或1)
+	 * 被钉住的页面可能正在被修改，只有pinned为true(调用者就是修改它们的线程，并且已经调用过logPinned)时才写回
+	 *   有shadow的页面还要不在组中；写回的是收集时的副本，计算校验和与写入期间页面不会再变
+	 */
+	int collectLocked(BufShard& s, int index, std::vector<FlushItem>& items, bool pinned = false) {
+		if (!dirty[index] || flushing[index]) {
+			return 0;
+		}
+		if (shadow[index] != nullptr && (!pinned || groupDepth > 0)) {
+			return 0;
+		}
+		if (pinCount[index] > 0 && !pinned) {
+			return 0;
+		}
+		FlushItem item;
+		s.hash->getKeys(index - s.base, item.fileID, item.pageID);
+		item.index = index;
+		item.failed = false;
+		item.lsn = pageLSN[index];
+		item.recLSN = recLSN[index];
+		item.copy = nullptr;
+		if (pinCount[index] > 0) {
+			item.copy = allocMem();
+			memcpy(item.copy, addr[index], PAGE_SIZE);
+		}
+		items.push_back(item);
+		recLSN[index] = 0;
+		// 写回开始前清除脏页标记，写回期间的修改会重新标记
+		setDirtyLocked(s, index, false);
+		flushing[index] = true;
+		return 1;
+	}
+	/*
+	 * 检查点需要写回一个被钉住的页面时，页面可能正在被修改，改为写回它的shadow的副本
+	 * shadow是页面上次写日志时的内容，和日志一致，pageLSN之前的日志落盘后就可以写回
+	 * 写回期间页面标记为flushing，解除钉住后不会被替换，也不会被再次钉住。页面仍然是脏的，之后的修改重新设置recLSN
+	 * 返回加入的页面数(0或1)，shadow中有还没有结束的组的修改时不能写回，返回0
+	 */
+	int collectShadowLocked(BufShard& s, int index, std::vector<FlushItem>& items) {
+		if (shadowOpen[index] || flushing[index]) {
+			return 0;
+		}
+		FlushItem item;
+		s.hash->getKeys(index - s.base, item.fileID, item.pageID);
+		item.index = index;
+		item.failed = false;
+		item.lsn = pageLSN[index];
+		item.recLSN = recLSN[index];
+		item.copy = allocMem();
+		memcpy(item.copy, shadow[index], PAGE_SIZE);
+		items.push_back(item);
+		recLSN[index] = 0;
+		flushing[index] = true;
+		return 1;
+	}
+	/*
+	 * 后台线程的一轮写回
+	 * 每个分片中，先清理即将被替换的页面，如果脏页比例仍然超过上限，再从flushCursor开始继续写回
+	 * 有检查点在进行时，再写回最多BUF_FLUSH_BATCH个recLSN在checkpointTarget之前的页面
+	 * 收集到的页面按(fileID,pageID)排序后写回，写回时不持有分片的latch
+	 * 调用者持有checkpointLatch
+	 * @参数redo:函数返回时，检查点需要的页面都已经写回时为恢复开始的位置，否则为0
+	 * 返回是否还有分片的脏页比例超过上限
+	 */
+	bool flushRound(ull& redo) {
+		std::lock_guard<std::mutex> io(flushLatch);
+		std::vector<FlushItem> items;
+		int limit = dirtyLimit();
+		bool more = false;
+		redo = 0;
+		if (log != nullptr && checkpointTarget == 0) {
+			ull cur = log->CurrentLSN();
+			if (cur > checkpointStart && (cur - checkpointStart >= LOG_CHECKPOINT_SIZE ||
+				std::chrono::steady_clock::now() - checkpointTime >= std::chrono::milliseconds(LOG_CHECKPOINT_INTERVAL))) {
+				checkpointTarget = cur;
+			}
+		}
+		// 还有recLSN在checkpointTarget之前、这一轮没有写回的页面
+		bool behind = false;
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufShard& s = shards[k];
+			std::lock_guard<std::mutex> guard(s.latch);
+			// 至少留一半的页面可以被替换
+			int budget = std::min(BUF_FLUSH_BATCH, shardCap >> 1);
+			int n = s.replace->candidates(flushCandidates, BUF_CLEAN_TARGET);
+			for (int i = 0; i < n && budget > 0; ++ i) {
+				budget -= collectLocked(s, s.base + flushCandidates[i], items);
+			}
+			for (int i = 0; i < shardCap && s.dirtyNum > limit && budget > 0; ++ i) {
+				budget -= collectLocked(s, s.base + s.flushCursor, items);
+				s.flushCursor = (s.flushCursor + 1) % shardCap;
+			}
+			if (s.dirtyNum > limit) {
+				more = true;
+			}
+			if (checkpointTarget == 0) {
+				continue;
+			}
+			budget = BUF_FLUSH_BATCH;
+			for (int i = s.base; i < s.base + shardCap; ++ i) {
+				if (recLSN[i] == 0 || recLSN[i] >= checkpointTarget) {
+					continue;
+				}
+				if (budget <= 0) {
+					behind = true;
+				} else if (shadow[i] == nullptr) {
+					budget -= collectLocked(s, i, items);
+				} else if (collectShadowLocked(s, i, items) > 0) {
+					-- budget;
+				} else {
+					// 组还没有结束，下一轮再试
+					behind = true;
+				}
+			}
+		}
+		writeItems(items);
+		finishItems(items);
+		if (checkpointTarget != 0 && !behind) {
+			redo = checkpointTarget;
+			for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+				BufShard& s = shards[k];
+				std::lock_guard<std::mutex> guard(s.latch);
+				for (int i = s.base; i < s.base + shardCap; ++ i) {
+					if (recLSN[i] != 0 && recLSN[i] < redo) {
+						redo = recLSN[i];
+					}
+				}
+			}
+			checkpointTarget = 0;
+		}
+		return more;
+	}
+	/*
+	 * 把collectLocked收集到的页面写回，调用时不持有分片的latch
+	 * 页面按(fileID,pageID)排序，同一文件中页号连续的页面合并为一段，每段最多BUF_WRITEV_MAX个，所有的段一次提交给writeIO
+	 * 写回失败的页面标记为failed
+	 */
+	void writeItems(std::vector<FlushItem>& items) {
+		std::sort(items.begin(), items.end());
+		// 先让这批页面的日志落盘
+		ull lsn = 0;
+		for (const FlushItem& item : items) {
+			lsn = std::max(lsn, item.lsn);
+		}
+		if (lsn != 0 && log != nullptr && !log->FlushTo(lsn)) {
+			for (FlushItem& item : items) {
+				item.failed = true;
+			}
+			return;
+		}
+		std::vector<BufType> bufs(items.size());
+		std::vector<PageRun> runs;
+		std::vector<size_t> firsts;
+		for (size_t i = 0; i < items.size(); ) {
+			size_t j = i;
+			int n = 0;
+			while (j < items.size() && n < BUF_WRITEV_MAX && items[j].fileID == items[i].fileID && items[j].pageID == items[i].pageID + n) {
+				bufs[j] = items[j].copy != nullptr ? items[j].copy : addr[items[j].index];
+				++ j;
+				++ n;
+			}
+			PageRun run;
+			run.fileID = items[i].fileID;
+			run.pageID = items[i].pageID;
+			run.n = n;
+			run.bufs = &bufs[i];
+			runs.push_back(run);
+			firsts.push_back(i);
+			i = j;
+		}
+		// 所有的段一起提交，使用io_uring时它们同时进行
+		if (fileManager->writeRuns(runs.data(), runs.size(), writeIO) == 0) {
+			return;
+		}
+		for (size_t r = 0; r < runs.size(); ++ r) {
+			if (runs[r].result != 0) {
+				for (int k = 0; k < runs[r].n; ++ k) {
+					items[firsts[r] + k].failed = true;
+				}
+			}
+		}
+	}
+	/*
+	 * 写回结束后清除页面的flushing标记，写回失败的页面重新标记为脏页
+	 * 返回是否全部写回成功
+	 */
+	bool finishItems(const std::vector<FlushItem>& items) {
+		bool ok = true;
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufShard& s = shards[k];
+			std::lock_guard<std::mutex> guard(s.latch);
+			for (const FlushItem& item : items) {
+				if (item.index / shardCap != k) {
+					continue;
+				}
+				flushing[item.index] = false;
+				free(item.copy);
+				if (item.failed) {
+					ok = false;
+					++ s.stats[item.fileID].ioErrors;
+					// shadow的副本写回失败时，页面本身一直是脏的
+					setDirtyLocked(s, item.index, true);
+					if (item.recLSN != 0 && (recLSN[item.index] == 0 || item.recLSN < recLSN[item.index])) {
+						recLSN[item.index] = item.recLSN;
+					}
+				} else {
+					++ s.stats[item.fileID].writeBacks;
+					s.stats[item.fileID].writeBytes += PAGE_SIZE;
+				}
+			}
+		}
+		return ok;
+	}
+	/*
+	 * 写回fileID的全部脏页，fileID为-1时写回所有文件的脏页
+	 * evict为true时，之后把这些页面归还给缓存管理器，被钉住的页面只写回，写回失败的页面也被归还
+	 * 调用者需要持有flushLatch，因此不会和后台线程的写回交错
+	 * 调用者是修改数据库的线程，被钉住的页面上的修改先写成日志，之后一起写回
+	 * 返回是否全部写回成功
+	 */
+	bool flushFrames(int fileID, bool evict) {
+		logPinned();
+		std::vector<FlushItem> items;
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufShard& s = shards[k];
+			std::lock_guard<std::mutex> guard(s.latch);
+			for (int i = 0; i < shardCap; ++ i) {
+				int f, p;
+				s.hash->getKeys(i, f, p);
+				if (f != -1 && (fileID == -1 || f == fileID)) {
+					collectLocked(s, s.base + i, items, true);
+				}
+			}
+		}
+		writeItems(items);
+		bool ok = finishItems(items);
+		if (!evict) {
+			return ok;
+		}
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufShard& s = shards[k];
+			std::lock_guard<std::mutex> guard(s.latch);
+			for (int i = 0; i < shardCap; ++ i) {
+				int f, p;
+				s.hash->getKeys(i, f, p);
+				// 写回期间又被修改的页面由writeBackLocked同步写回
+				if (f != -1 && (fileID == -1 || f == fileID)) {
+					ok = writeBackLocked(s, s.base + i, true) && ok;
+				}
+			}
+		}
+		return ok;
+	}
+	void flusherLoop() {
+		std::unique_lock<std::mutex> lock(flusherMutex);
+		while (flusherRunning) {
+			lock.unlock();
+			bool more;
+			{
+				// 检查点的落盘不持有flushLatch，不会挡住写回和关闭文件
+				std::lock_guard<std::mutex> ck(checkpointLatch);
+				ull redo;
+				more = flushRound(redo);
+				if (redo != 0) {
+					log->Checkpoint(redo);
+					checkpointStart = log->CurrentLSN();
+					checkpointTime = std::chrono::steady_clock::now();
+				}
+			}
+			lock.lock();
+			if (!more && flusherRunning) {
+				flusherCond.wait_for(lock, std::chrono::milliseconds(flushInterval.load()));
+			}
+		}
+	}
+	/*
+	 * 记录对(fileID,pageID)的访问，连续访问了BUF_READ_AHEAD_TRIGGER个相邻页面后，请求预读之后的BUF_READ_AHEAD个页面
+	 * 预读的页面被访问时会继续推进预读窗口
+	 * mapped为true时文件被映射到内存中，不经过预读线程，而是用madvise让内核在后台读入
+	 */
+	void noteAccess(int fileID, int pageID, bool mapped = false) {
+		if (BUF_READ_AHEAD == 0 || (!mapped && !prefetcherRunning)) {
+			return;
+		}
+		ReadAheadState& ra = readAhead[fileID];
+		int last = ra.lastPage.exchange(pageID, std::memory_order_relaxed);
+		if (pageID == last) {
+			return;
+		}
+		if (pageID != last + 1) {
+			ra.runLength.store(0, std::memory_order_relaxed);
+			ra.aheadTo.store(pageID, std::memory_order_relaxed);
+			return;
+		}
+		if (ra.runLength.fetch_add(1, std::memory_order_relaxed) + 1 < BUF_READ_AHEAD_TRIGGER) {
+			return;
+		}
+		// 预读窗口剩下不到一半时再补充，避免每访问一个页面就请求一次
+		int from = ra.aheadTo.load(std::memory_order_relaxed);
+		if (from - pageID > BUF_READ_AHEAD / 2) {
+			return;
+		}
+		if (from < pageID) {
+			from = pageID;
+		}
+		int to = pageID + BUF_READ_AHEAD;
+		ra.aheadTo.store(to, std::memory_order_relaxed);
+		if (mapped) {
+			fileManager->adviseWillNeed(fileID, from + 1, to - from);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(prefetchMutex);
+		for (int p = from + 1; p <= to && (int)prefetchQueue.size() < BUF_PREFETCH_QUEUE; ++ p) {
+			prefetchQueue.push_back(std::make_pair(fileID, p));
+		}
+		prefetchCond.notify_one();
+	}
+	/*
+	 * 在不持有分片latch的情况下从磁盘读入一批页面，再放入缓存
+	 * 同一文件中页号连续的请求合并为一段，所有的段一次提交给readIO
+	 * 如果读盘期间页面已经被别人读入，或者分片中有脏页被写回(读到的内容可能已经过时)，放弃这个页面
+	 */
+	void prefetchBatch(const std::pair<int, int>* requests, int n) {
+		std::vector<std::pair<int, int>> pages;
+		std::vector<ull> seqs;
+		for (int i = 0; i < n; ++ i) {
+			int fileID = requests[i].first, pageID = requests[i].second;
+			BufShard& s = shardOf(fileID, pageID);
+			std::lock_guard<std::mutex> guard(s.latch);
+			if (s.hash->findIndex(fileID, pageID) == -1) {
+				pages.push_back(requests[i]);
+				seqs.push_back(s.writeSeq);
+			}
+		}
+		std::vector<PageRun> runs;
+		std::vector<int> runOf(pages.size(), -1);
+		int lastFile = -1, fileEnd = 0;
+		for (size_t i = 0; i < pages.size(); ++ i) {
+			int fileID = pages[i].first, pageID = pages[i].second;
+			if (fileID != lastFile) {
+				lastFile = fileID;
+				fileEnd = fileManager->pageCount(fileID);
+			}
+			// 文件末尾之后的页面还没有被写过，没有可读的内容
+			if (pageID >= fileEnd) {
+				continue;
+			}
+			if (!runs.empty() && i > 0 && runOf[i - 1] == (int)runs.size() - 1) {
+				PageRun& last = runs.back();
+				if (last.fileID == fileID && last.pageID + last.n == pageID && last.n < BUF_WRITEV_MAX) {
+					last.n++;
+					runOf[i] = runs.size() - 1;
+					continue;
+				}
+			}
+			PageRun run;
+			run.fileID = fileID;
+			run.pageID = pageID;
+			run.n = 1;
+			run.bufs = prefetchBufs + i;
+			runs.push_back(run);
+			runOf[i] = runs.size() - 1;
+		}
+		fileManager->readRuns(runs.data(), runs.size(), readIO);
+		for (size_t i = 0; i < pages.size(); ++ i) {
+			if (runOf[i] == -1) {
+				continue;
+			}
+			int fileID = pages[i].first, pageID = pages[i].second;
+			BufShard& s = shardOf(fileID, pageID);
+			std::lock_guard<std::mutex> guard(s.latch);
+			if (runs[runOf[i]].result != 0) {
+				++ s.stats[fileID].ioErrors;
+				if (runs[runOf[i]].result == FILE_PAGE_CORRUPT) {
+					++ s.stats[fileID].corruptPages;
+				}
+				continue;
+			}
+			if (s.writeSeq != seqs[i] || s.hash->findIndex(fileID, pageID) != -1) {
+				continue;
+			}
+			int index;
+			BufType b = fetchPageLocked(s, fileID, pageID, index);
+			if (b == nullptr) {
+				continue;
+			}
+			memcpy(b, prefetchBufs[i], PAGE_SIZE);
+			++ s.stats[fileID].prefetches;
+			s.stats[fileID].readBytes += PAGE_SIZE;
+		}
+	}
+	void prefetcherLoop() {
+		std::pair<int, int> requests[BUF_PREFETCH_BATCH];
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(prefetchMutex);
+				prefetchCond.wait(lock, [this] { return !prefetcherRunning || !prefetchQueue.empty(); });
+				if (!prefetcherRunning) {
+					return;
+				}
+			}
+			std::lock_guard<std::mutex> io(prefetchLatch);
+			int n = 0;
+			{
+				std::lock_guard<std::mutex> lock(prefetchMutex);
+				while (n < BUF_PREFETCH_BATCH && !prefetchQueue.empty()) {
+					requests[n++] = prefetchQueue.front();
+					prefetchQueue.pop_front();
+				}
+			}
+			prefetchBatch(requests, n);
+		}
+	}
+	static Replacer* createReplacer(int policy, int c) {
+		switch (policy) {
+		case REPLACE_LRU:
+			return new FindReplace(c);
+		case REPLACE_2Q:
+			return new TwoQReplace(c);
+		default:
+			printf("In BufPageManager, unknown replace policy %d, using LRU\n", policy);
+			return new FindReplace(c);
+		}
+	}
+	/*
+	 * 为frames个页面申请一整块内存，优先使用大页
+	 * 匿名映射的内存在第一次访问时才真正分配，缓存再大也不会拖慢启动
+	 */
+	void allocArena(int frames) {
+		size_t bytes = (size_t)frames << PAGE_SIZE_IDX;
+		arenaSize = (bytes + BUF_ARENA_ALIGN - 1) / BUF_ARENA_ALIGN * BUF_ARENA_ALIGN;
+		void* p = MAP_FAILED;
+		hugePages = false;
+#if BUF_USE_HUGETLB && defined(MAP_HUGETLB)
+		p = mmap(NULL, arenaSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		hugePages = p != MAP_FAILED;
+#endif
+		if (p == MAP_FAILED) {
+			// 多申请BUF_ARENA_ALIGN字节，保证可以对齐到大页边界，透明大页才能生效
+			// 对齐后把前后多出来的部分还给系统，剩下的映射正好是[arena, arena + arenaSize)
+			void* raw = mmap(NULL, arenaSize + BUF_ARENA_ALIGN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (raw == MAP_FAILED) {
+				printf("In BufPageManager, cannot map %zu bytes for %d frames\n", arenaSize, frames);
+				assert(false);
+			}
+			p = (void*)(((size_t)raw + BUF_ARENA_ALIGN - 1) / BUF_ARENA_ALIGN * BUF_ARENA_ALIGN);
+			size_t head = (uchar*)p - (uchar*)raw;
+			if (head > 0) {
+				munmap(raw, head);
+			}
+			munmap((uchar*)p + arenaSize, BUF_ARENA_ALIGN - head);
+#ifdef MADV_HUGEPAGE
+			madvise(p, arenaSize, MADV_HUGEPAGE);
+#endif
+		}
+		arena = (uchar*)p;
+	}
+	/*
+	 * 由环境变量DBMS_BUFFER_MB决定缓存页面个数，没有设置或不合法时为CAP
+	 * 结果向下取整为BUF_SHARD_NUM的倍数，且每个分片至少有BUF_MIN_SHARD_FRAMES个页面
+	 */
+	static int framesFromBudget() {
+		long long frames = CAP;
+		const char* budget = getenv("DBMS_BUFFER_MB");
+		if (budget != NULL) {
+			long long mb = atoll(budget);
+			if (mb > 0) {
+				frames = (mb << 20) >> PAGE_SIZE_IDX;
+			} else {
+				printf("In BufPageManager, illegal DBMS_BUFFER_MB \"%s\", using %d frames\n", budget, CAP);
+			}
+		}
+		if (frames > (1 << 30) / BUF_SHARD_NUM * BUF_SHARD_NUM) {
+			frames = (1 << 30) / BUF_SHARD_NUM * BUF_SHARD_NUM;
+		}
+		frames -= frames % BUF_SHARD_NUM;
+		if (frames < BUF_SHARD_NUM * BUF_MIN_SHARD_FRAMES) {
+			frames = BUF_SHARD_NUM * BUF_MIN_SHARD_FRAMES;
+		}
+		return (int)frames;
+	}
+	static BufPageManager *instance;
+	
+	/*
+	 * 构造函数
+	 * @参数fm:文件管理器，缓存管理器需要利用文件管理器与磁盘进行交互
+	 * @参数frames:缓存页面个数，需要是BUF_SHARD_NUM的倍数
+	 * @参数policy:替换算法, REPLACE_LRU或REPLACE_2Q
+	 */
+	BufPageManager(FileManager* fm, int frames, int policy = BUF_REPLACE_POLICY) {
+		int c = frames / BUF_SHARD_NUM;
+		frameNum = frames;
+		shardCap = c;
+		fileManager = fm;
+		//bpl = new MyLinkList(CAP, MAX_FILE_NUM);
+		dirty = new bool[frames];
+		pinCount = new int[frames];
+		flushing = new bool[frames];
+		addr = new BufType[frames];
+		pageLSN = new ull[frames];
+		recLSN = new ull[frames];
+		shadow = new uchar*[frames];
+		shadowOpen = new bool[frames];
+		log = nullptr;
+		groupDepth = 0;
+		groupStart = 0;
+		checkpointTarget = checkpointStart = 0;
+		checkpointTime = std::chrono::steady_clock::now();
+		allocArena(frames);
+		flusherRunning = false;
+		maxDirtyPercent = BUF_MAX_DIRTY_PERCENT;
+		flushInterval = BUF_FLUSH_INTERVAL;
+		flushCandidates = new int[BUF_CLEAN_TARGET];
+		prefetcherRunning = false;
+		prefetchBufs = new BufType[BUF_PREFETCH_BATCH];
+		for (int i = 0; i < BUF_PREFETCH_BATCH; ++ i) {
+			prefetchBufs[i] = allocMem();
+		}
+		writeIO = new AsyncIO();
+		readIO = new AsyncIO();
+		ringCap = std::max((BUF_RING_SIZE >> PAGE_SIZE_IDX) / BUF_SHARD_NUM, BUF_RING_MIN_SHARD_FRAMES);
+		ringCap = std::min(ringCap, c >> 2);
+		for (int i = 0; i < MAX_FILE_NUM; ++ i) {
+			readAhead[i].lastPage = -1;
+			readAhead[i].runLength = 0;
+			readAhead[i].aheadTo = -1;
+			mappedReads[i] = 0;
+			bulkRefs[i] = 0;
+		}
+		shards = new BufShard[BUF_SHARD_NUM];
+		for (int i = 0; i < BUF_SHARD_NUM; ++ i) {
+			shards[i].hash = new PageTable(c);
+			shards[i].replace = createReplacer(policy, c);
+			shards[i].base = i * c;
+			shards[i].last = -1;
+			shards[i].dirtyNum = 0;
+			shards[i].flushCursor = 0;
+			shards[i].writeSeq = 0;
+			shards[i].stats = new BufStats[MAX_FILE_NUM];
+			shards[i].rings = new BufRing*[MAX_FILE_NUM];
+			for (int f = 0; f < MAX_FILE_NUM; ++ f) {
+				shards[i].rings[f] = nullptr;
+			}
+		}
+		for (int i = 0; i < frames; ++ i) {
+			dirty[i] = false;
+			pinCount[i] = 0;
+			flushing[i] = false;
+			pageLSN[i] = recLSN[i] = 0;
+			shadow[i] = nullptr;
+			shadowOpen[i] = false;
+			addr[i] = (BufType)(arena + ((size_t)i << PAGE_SIZE_IDX));
+		}
+	}
+public:
+	/*
+	 * 析构函数
+	 * 功能:停止后台线程，释放构造函数和allocArena申请的所有内存，关闭AsyncIO
+	 *           不会写回脏页，需要时先调用close
+	 */
+	~BufPageManager() {
+		stopFlusher();
+		stopPrefetcher();
+		for (int i = 0; i < BUF_SHARD_NUM; ++ i) {
+			delete shards[i].hash;
+			delete shards[i].replace;
+			delete[] shards[i].stats;
+			for (int f = 0; f < MAX_FILE_NUM; ++ f) {
+				BufRing* ring = shards[i].rings[f];
+				if (ring != nullptr) {
+					delete[] ring->frames;
+					delete[] ring->pages;
+					delete ring;
+				}
+			}
+			delete[] shards[i].rings;
+		}
+		delete[] shards;
+		delete writeIO;
+		delete readIO;
+		for (int i = 0; i < BUF_PREFETCH_BATCH; ++ i) {
+			free(prefetchBufs[i]);
+		}
+		delete[] prefetchBufs;
+		delete[] flushCandidates;
+		for (int i = 0; i < frameNum; ++ i) {
+			free(shadow[i]);
+		}
+		delete[] dirty;
+		delete[] pinCount;
+		delete[] flushing;
+		delete[] addr;
+		delete[] pageLSN;
+		delete[] recLSN;
+		delete[] shadow;
+		delete[] shadowOpen;
+		munmap(arena, arenaSize);
+		if (instance == this) {
+			instance = nullptr;
+		}
+	}
+	/*
+	 * @函数名allocPage
+	 * @参数fileID:文件id，数据库程序在运行时，用文件id来区分正在打开的不同的文件
+	 * @参数pageID:文件页号，表示在fileID指定的文件中，第几个文件页
+	 * @参数index:函数返回时，用来记录缓存页面数组中的下标
+	 * @参数ifRead:是否要将文件页中的内容读到缓存中
+	 * 返回:缓存页面的首地址，读写出错或缓存页面全部被钉住时返回nullptr，index为-1
+	 * 功能:为文件中的某一个页面获取一个缓存中的页面
+	 *           缓存中的页面在缓存页面数组中的下标记录在index中
+	 *           并根据ifRead是否为true决定是否将文件中的内容写到获取的缓存页面中
+	 * 注意:在调用函数allocPage之前，调用者必须确信(fileID,pageID)指定的文件页面不存在缓存中
+	 *           如果确信指定的文件页面不在缓存中，那么就不用在hash表中进行查找，直接调用替换算法，节省时间
+	 */
+	BufType allocPage(int fileID, int pageID, int& index, bool ifRead = false) {
+		if (fileManager->isMapped(fileID)) {
+			printf("In BufPageManager::allocPage, file %d is opened read-only\n", fileID);
+			index = -1;
+			return nullptr;
+		}
+		BufShard& s = shardOf(fileID, pageID);
+		std::lock_guard<std::mutex> guard(s.latch);
+		BufType b = fetchPageLocked(s, fileID, pageID, index);
+		if (b == nullptr) {
+			return nullptr;
+		}
+		++ s.stats[fileID].misses;
+		if (ifRead && !readLocked(s, fileID, pageID, index)) {
+			return nullptr;
+		}
+		return b;
+	}
+	/*
+	 * @函数名getPage
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * @参数index:函数返回时，用来记录缓存页面数组中的下标
+	 * 返回:缓存页面的首地址，读写出错或缓存页面全部被钉住时返回nullptr，index为-1
+	 * 功能:为文件中的某一个页面在缓存中找到对应的缓存页面
+	 *           文件页面由(fileID,pageID)指定
+	 *           缓存中的页面在缓存页面数组中的下标记录在index中
+	 *           首先，在hash表中查找(fileID,pageID)对应的缓存页面，
+	 *           如果能找到，那么表示文件页面在缓存中
+	 *           如果没有找到，那么就利用替换算法获取一个页面
+	 *           文件只读打开并被映射到内存中时，直接返回映射中的地址，index为BUF_MAPPED_INDEX，这个页面不能修改
+	 * 注意:返回的页面没有被钉住，多线程访问时应使用pinPage
+	 */
+	BufType getPage(int fileID, int pageID, int& index) {
+		BufType b = mappedPage(fileID, pageID, index);
+		if (b != nullptr) {
+			return b;
+		}
+		{
+			BufShard& s = shardOf(fileID, pageID);
+			std::lock_guard<std::mutex> guard(s.latch);
+			b = getPageLocked(s, fileID, pageID, index);
+		}
+		if (b != nullptr) {
+			noteAccess(fileID, pageID);
+		}
+		return b;
+	}
+	/**
+	 * Similar to getPage, except that you have a suspect for index
+	 * Faster than getPage sometimes and won't be noticably slower than it in any occasion
+	 * Use uchar* instead of uint* for argument and return value
+	*/
+	uchar* reusePage(int fileID, int pageID, int& index, uchar* buf){
+		if(buf == nullptr || index == BUF_MAPPED_INDEX)
+			return (uchar*)getPage(fileID, pageID, index);
+		BufShard& s = shardOf(index);
+		{
+			std::lock_guard<std::mutex> guard(s.latch);
+			int tmpFID, tmpPID;
+			s.hash->getKeys(index - s.base, tmpFID, tmpPID);
+			if(tmpFID == fileID && tmpPID == pageID){
+				accessLocked(s, index);
+				return buf;
+			}
+		}
+		return (uchar*)getPage(fileID, pageID, index);
+	}
+	/*
+	 * @函数名pinPage
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * @参数index:函数返回时，用来记录缓存页面数组中的下标
+	 * 返回:缓存页面的首地址，读写出错或缓存页面全部被钉住时返回nullptr，index为-1，此时页面没有被钉住
+	 * 功能:与getPage相同，但同时钉住该缓存页面
+	 *           在对应的unpin被调用之前，页面不会被替换，返回的地址和index一直有效，不需要再用getKey检查
+	 *           写日志的文件的页面正在被后台线程写回时，等写回结束再钉住，否则写到磁盘上的内容可能包含还没有写日志的修改
+	 */
+	uchar* pinPage(int fileID, int pageID, int& index) {
+		uchar* b = (uchar*)mappedPage(fileID, pageID, index);
+		if (b != nullptr) {
+			// 映射中的页面一直有效，不需要钉住
+			return b;
+		}
+		bool logged = isLogged(fileID);
+		while (true) {
+			{
+				BufShard& s = shardOf(fileID, pageID);
+				std::lock_guard<std::mutex> guard(s.latch);
+				b = (uchar*)getPageLocked(s, fileID, pageID, index);
+				if (b == nullptr) {
+					return nullptr;
+				}
+				if (!logged || pinCount[index] > 0 || !flushing[index]) {
+					pinLocked(s, index);
+					break;
+				}
+			}
+			std::this_thread::yield();
+		}
+		noteAccess(fileID, pageID);
+		return b;
+	}
+	/*
+	 * @函数名pin
+	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
+	 * 功能:钉住index代表的缓存页面，可以重复钉住，每次pin需要对应一次unpin
+	 */
+	void pin(int index) {
+		if (index == BUF_MAPPED_INDEX) {
+			return;
+		}
+		BufShard& s = shardOf(index);
+		std::lock_guard<std::mutex> guard(s.latch);
+		pinLocked(s, index);
+	}
+	/*
+	 * @函数名unpin
+	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
+	 * 功能:解除一次对index代表的缓存页面的钉住，最后一次解除后页面重新交给替换算法管理
+	 */
+	void unpin(int index) {
+		if (index == BUF_MAPPED_INDEX) {
+			return;
+		}
+		BufShard& s = shardOf(index);
+		std::lock_guard<std::mutex> guard(s.latch);
+		if (pinCount[index] <= 0) {
+			printf("In BufPageManager::unpin, frame %d is not pinned\n", index);
+			return;
+		}
+		if (pinCount[index] == 1 && shadow[index] != nullptr && !releaseShadowLocked(s, index)) {
+			return;
+		}
+		if (--pinCount[index] == 0) {
+			s.replace->unpin(index - s.base);
+			s.last = index;
+		}
+	}
+	bool isPinned(int index) {
+		if (index == BUF_MAPPED_INDEX) {
+			return false;
+		}
+		BufShard& s = shardOf(index);
+		std::lock_guard<std::mutex> guard(s.latch);
+		return pinCount[index] > 0;
+	}
+	/*
+	 * @函数名access
+	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
+	 * 功能:标记index代表的缓存页面被访问过，为替换算法提供信息
+	 *           被钉住的页面不在替换算法的队列中，不需要标记
+	 */
+	void access(int index) {
+		if (index == BUF_MAPPED_INDEX) {
+			return;
+		}
+		BufShard& s = shardOf(index);
+		std::lock_guard<std::mutex> guard(s.latch);
+		accessLocked(s, index);
+	}
+	/*
+	 * @函数名markDirty
+	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
+	 * 功能:标记index代表的缓存页面被写过，保证替换算法在执行时能进行必要的写回操作，
+	 *           保证数据的正确性
+	 */
+	void markDirty(int index) {
+		if (index == BUF_MAPPED_INDEX) {
+			printf("In BufPageManager::markDirty, a page of a read-only file cannot be modified\n");
+			return;
+		}
+		BufShard& s = shardOf(index);
+		{
+			std::lock_guard<std::mutex> guard(s.latch);
+			setDirtyLocked(s, index, true);
+			accessLocked(s, index);
+			if (s.dirtyNum <= dirtyLimit()) {
+				return;
+			}
+		}
+		// 脏页太多，不等下一轮，立刻唤醒后台线程
+		flusherCond.notify_one();
+	}
+	/*
+	 * @函数名release
+	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
+	 * 功能:将index代表的缓存页面归还给缓存管理器，在归还前，缓存页面中的数据不标记写回
+	 *           被钉住的页面仍在使用中，不能归还
+	 */
+	void release(int index) {
+		if (index == BUF_MAPPED_INDEX) {
+			return;
+		}
+		BufShard& s = shardOf(index);
+		std::lock_guard<std::mutex> guard(s.latch);
+		if (pinCount[index] > 0 || flushing[index]) {
+			return;
+		}
+		setDirtyLocked(s, index, false);
+		recLSN[index] = 0;
+		s.replace->free(index - s.base);
+		s.hash->remove(index - s.base);
+	}
+	/*
+	 * @函数名writeBack
+	 * @参数index:缓存页面数组中的下标，用来表示一个缓存页面
+	 * 功能:将index代表的缓存页面归还给缓存管理器，在归还前，缓存页面中的数据需要根据脏页标记决定是否写到对应的文件页面中
+	 *           被钉住的页面只写回，不归还
+	 * 返回:写回是否成功，失败时页面留在缓存中，仍然是脏的
+	 */
+	bool writeBack(int index) {
+		if (index == BUF_MAPPED_INDEX) {
+			return true;
+		}
+		BufShard& s = shardOf(index);
+		std::lock_guard<std::mutex> guard(s.latch);
+		return writeBackLocked(s, index);
+	}
+	/*
+	 * @函数名close
+	 * 功能:将所有缓存页面归还给缓存管理器，归还前需要根据脏页标记决定是否写到对应的文件页面中
+	 *           脏页按文件和页号排序后批量写回
+	 * 返回:是否全部写回成功，写回失败的页面也会被归还
+	 */
+	bool close() {
+		std::lock_guard<std::mutex> io(flushLatch);
+		return flushFrames(-1, true);
+	}
+	/*
+	 * @函数名flushAll
+	 * 功能:把所有脏页批量写回，页面仍留在缓存中，用于检查点
+	 * 返回:是否全部写回成功，写回失败的页面仍然是脏的
+	 */
+	bool flushAll() {
+		std::lock_guard<std::mutex> io(flushLatch);
+		return flushFrames(-1, false);
+	}
+	/*
+	 * @函数名flushFile
+	 * @参数fileID:文件id
+	 * 功能:将属于fileID的缓存页面全部写回并归还给缓存管理器，被钉住的页面只写回
+	 *           脏页按页号排序，连续的页面合并为一次pwritev
+	 *           在关闭文件之前调用，之后这个fileID被其他文件复用时不会读到旧文件的缓存
+	 * 返回:是否全部写回成功，写回失败的页面也会被归还
+	 */
+	bool flushFile(int fileID) {
+		std::lock_guard<std::mutex> io(flushLatch);
+		std::lock_guard<std::mutex> prefetchIO(prefetchLatch);
+		{
+			std::lock_guard<std::mutex> lock(prefetchMutex);
+			for (auto it = prefetchQueue.begin(); it != prefetchQueue.end(); ) {
+				if (it->first == fileID) {
+					it = prefetchQueue.erase(it);
+				} else {
+					++ it;
+				}
+			}
+		}
+		readAhead[fileID].lastPage = -1;
+		readAhead[fileID].runLength = 0;
+		readAhead[fileID].aheadTo = -1;
+		return flushFrames(fileID, true);
+	}
+	/*
+	 * @函数名startFlusher
+	 * 功能:启动后台写回线程
+	 *           后台线程每隔flushInterval毫秒，或者某个分片的脏页比例超过上限时，写回一批脏页
+	 */
+	void startFlusher() {
+		std::lock_guard<std::mutex> lock(flusherMutex);
+		if (flusherRunning) {
+			return;
+		}
+		flusherRunning = true;
+		flusher = std::thread(&BufPageManager::flusherLoop, this);
+	}
+	/*
+	 * @函数名stopFlusher
+	 * 功能:停止后台写回线程，等待正在进行的一轮写回结束
+	 */
+	void stopFlusher() {
+		{
+			std::lock_guard<std::mutex> lock(flusherMutex);
+			if (!flusherRunning) {
+				return;
+			}
+			flusherRunning = false;
+		}
+		flusherCond.notify_all();
+		flusher.join();
+	}
+	/*
+	 * @函数名startBulk
+	 * @参数fileID:文件id
+	 * 功能:开始对fileID的批量操作，比如COPY、建索引时的全表扫描、没有索引可用的DELETE
+	 *           之后fileID中不在缓存里的页面都读入一个私有的环形缓冲区(共BUF_RING_SIZE字节)并循环复用，
+	 *           不会把共享缓存中的其他页面挤出去。已经在缓存中的页面照常使用
+	 *           可以嵌套，每次startBulk需要对应一次endBulk，最好通过BulkAccess使用
+	 */
+	void startBulk(int fileID) {
+		std::lock_guard<std::mutex> lock(bulkLatch);
+		if (bulkRefs[fileID]++ > 0) {
+			return;
+		}
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufRing* ring = new BufRing;
+			ring->frames = new int[ringCap];
+			ring->pages = new int[ringCap];
+			ring->pos = 0;
+			for (int i = 0; i < ringCap; ++ i) {
+				ring->frames[i] = ring->pages[i] = -1;
+			}
+			std::lock_guard<std::mutex> guard(shards[k].latch);
+			shards[k].rings[fileID] = ring;
+		}
+	}
+	/*
+	 * @函数名endBulk
+	 * @参数fileID:文件id
+	 * 功能:结束一次startBulk开始的批量操作，最后一次结束时丢弃环形缓冲区
+	 *           环中的页面留在缓存里，之后和其他页面一样由替换算法管理
+	 */
+	void endBulk(int fileID) {
+		std::lock_guard<std::mutex> lock(bulkLatch);
+		if (bulkRefs[fileID] <= 0) {
+			printf("In BufPageManager::endBulk, file %d is not in a bulk operation\n", fileID);
+			return;
+		}
+		if (--bulkRefs[fileID] > 0) {
+			return;
+		}
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufRing* ring;
+			{
+				std::lock_guard<std::mutex> guard(shards[k].latch);
+				ring = shards[k].rings[fileID];
+				shards[k].rings[fileID] = nullptr;
+			}
+			delete[] ring->frames;
+			delete[] ring->pages;
+			delete ring;
+		}
+	}
+	/*
+	 * @函数名prefetch
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 功能:提示预读线程(fileID,pageID)马上会被访问，预读线程没有运行或者队列已满时忽略
+	 *           用于无法从页号看出的顺序访问，比如B+树叶节点的链表
+	 *           被映射到内存中的文件不经过缓存，改为提示内核读入这个页面
+	 */
+	void prefetch(int fileID, int pageID) {
+		if (fileManager->isMapped(fileID)) {
+			fileManager->adviseWillNeed(fileID, pageID, 1);
+			return;
+		}
+		std::lock_guard<std::mutex> lock(prefetchMutex);
+		if (!prefetcherRunning || (int)prefetchQueue.size() >= BUF_PREFETCH_QUEUE) {
+			return;
+		}
+		prefetchQueue.push_back(std::make_pair(fileID, pageID));
+		prefetchCond.notify_one();
+	}
+	/*
+	 * @函数名startPrefetcher
+	 * 功能:启动预读线程
+	 */
+	void startPrefetcher() {
+		std::lock_guard<std::mutex> lock(prefetchMutex);
+		if (prefetcherRunning) {
+			return;
+		}
+		prefetcherRunning = true;
+		prefetcher = std::thread(&BufPageManager::prefetcherLoop, this);
+	}
+	/*
+	 * @函数名stopPrefetcher
+	 * 功能:停止预读线程，丢弃还没有处理的预读请求
+	 */
+	void stopPrefetcher() {
+		{
+			std::lock_guard<std::mutex> lock(prefetchMutex);
+			if (!prefetcherRunning) {
+				return;
+			}
+			prefetcherRunning = false;
+			prefetchQueue.clear();
+		}
+		prefetchCond.notify_all();
+		prefetcher.join();
+	}
+	/*
+	 * @函数名setFlushPolicy
+	 * @参数dirtyPercent:每个分片中脏页的比例上限(百分比)
+	 * @参数intervalMs:两轮写回之间的间隔(毫秒)
+	 */
+	void setFlushPolicy(int dirtyPercent, int intervalMs) {
+		maxDirtyPercent = dirtyPercent;
+		flushInterval = intervalMs;
+		flusherCond.notify_one();
+	}
+	/*
+	 * @函数名getKey
+	 * @参数index:缓存页面数组中的下标，用来指定一个缓存页面
+	 * @参数fileID:函数返回时，用于存储指定缓存页面所属的文件号
+	 * @参数pageID:函数返回时，用于存储指定缓存页面对应的文件页号
+	 *           index为BUF_MAPPED_INDEX时都为-1
+	 */
+	void getKey(int index, int& fileID, int& pageID) {
+		if (index == BUF_MAPPED_INDEX) {
+			fileID = pageID = -1;
+			return;
+		}
+		BufShard& s = shardOf(index);
+		std::lock_guard<std::mutex> guard(s.latch);
+		s.hash->getKeys(index - s.base, fileID, pageID);
+	}
+	
+	/*
+	 * @函数名getStats
+	 * @参数perFile:不为nullptr时，函数返回时perFile[fileID]存放fileID的统计，需要有MAX_FILE_NUM个元素
+	 * @参数shard:不为nullptr时，函数返回时shard[k]存放第k个分片的统计，需要有BUF_SHARD_NUM个元素
+	 * 返回:整个缓存的统计
+	 * 功能:汇总各分片的计数器，并扫描缓存页面得到每个文件驻留在缓存中的页面数和脏页数
+	 *           各分片依次加锁，结果不是同一时刻的快照
+	 */
+	BufStats getStats(BufStats* perFile = nullptr, BufStats* shard = nullptr) {
+		BufStats total;
+		if (perFile != nullptr) {
+			for (int f = 0; f < MAX_FILE_NUM; ++ f) {
+				perFile[f] = BufStats();
+			}
+		}
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufShard& s = shards[k];
+			BufStats shardTotal;
+			std::lock_guard<std::mutex> guard(s.latch);
+			for (int i = 0; i < shardCap; ++ i) {
+				int f, p;
+				s.hash->getKeys(i, f, p);
+				if (f != -1) {
+					++ s.stats[f].resident;
+					s.stats[f].dirtyPages += dirty[s.base + i];
+				}
+			}
+			for (int f = 0; f < MAX_FILE_NUM; ++ f) {
+				shardTotal.add(s.stats[f]);
+				if (perFile != nullptr) {
+					perFile[f].add(s.stats[f]);
+				}
+				s.stats[f].resident = s.stats[f].dirtyPages = 0;
+			}
+			if (shard != nullptr) {
+				shard[k] = shardTotal;
+			}
+			total.add(shardTotal);
+		}
+		// 映射中的页面不属于任何分片，只计入文件和总体的统计
+		for (int f = 0; f < MAX_FILE_NUM; ++ f) {
+			ull n = mappedReads[f].load(std::memory_order_relaxed);
+			total.mappedReads += n;
+			if (perFile != nullptr) {
+				perFile[f].mappedReads += n;
+			}
+		}
+		return total;
+	}
+	/*
+	 * @函数名resetStats
+	 * 功能:将所有计数器清零
+	 */
+	void resetStats() {
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			std::lock_guard<std::mutex> guard(shards[k].latch);
+			for (int f = 0; f < MAX_FILE_NUM; ++ f) {
+				shards[k].stats[f] = BufStats();
+			}
+		}
+		for (int f = 0; f < MAX_FILE_NUM; ++ f) {
+			mappedReads[f] = 0;
+		}
+	}
+	/*
+	 * @函数名capacity
+	 * 返回:缓存页面个数
+	 */
+	int capacity() {
+		return frameNum;
+	}
+	/*
+	 * @函数名usingAsyncIO
+	 * 返回:批量读写是否在使用io_uring
+	 */
+	bool usingAsyncIO() {
+		return writeIO->usingUring();
+	}
+	/*
+	 * @函数名usingHugePages
+	 * 返回:缓存页面是否位于MAP_HUGETLB申请的大页中
+	 */
+	bool usingHugePages() {
+		return hugePages;
+	}
+	/*
+	 * @函数名setLog
+	 * @参数l:日志，为nullptr时不再写日志
+	 * 功能:设置预写日志，之后LogManager::Attach过的文件的页面在被钉住期间的修改都会写日志
+	 *           更换日志前，写日志的文件必须都已经写回并关闭，仍被钉住的页面不再写日志
+	 *           正在进行的检查点被放弃
+	 */
+	void setLog(LogManager* l) {
+		std::lock_guard<std::mutex> ck(checkpointLatch);
+		std::lock_guard<std::mutex> io(flushLatch);
+		std::lock_guard<std::mutex> prefetchIO(prefetchLatch);
+		std::vector<int> frames;
+		{
+			std::lock_guard<std::mutex> lock(logLatch);
+			frames = shadowFrames;
+		}
+		for (int index : frames) {
+			BufShard& s = shardOf(index);
+			std::lock_guard<std::mutex> guard(s.latch);
+			dropShadowLocked(index);
+		}
+		for (int k = 0; k < BUF_SHARD_NUM; ++ k) {
+			BufShard& s = shards[k];
+			std::lock_guard<std::mutex> guard(s.latch);
+			for (int i = s.base; i < s.base + shardCap; ++ i) {
+				recLSN[i] = 0;
+			}
+		}
+		// 组在这之前都已经结束，groupHeld为空
+		log = l;
+		groupDepth = 0;
+		checkpointTarget = 0;
+		checkpointStart = l != nullptr ? l->CurrentLSN() : 0;
+		checkpointTime = std::chrono::steady_clock::now();
+	}
+	/*
+	 * @函数名isLogged
+	 * 返回:fileID的修改是否写日志，只由修改数据库的线程调用
+	 */
+	bool isLogged(int fileID) {
+		return log != nullptr && fileID >= 0 && log->IsAttached(fileID);
+	}
+	/*
+	 * @函数名beginGroup
+	 * 功能:开始一组修改，比如一次插入需要修改位图页、表头页和数据页，B+树的一次插入可能需要分裂多个节点
+	 *           组中修改过的页面在endGroup之前不会被写回，endGroup时一起写成日志并以一条END结束
+	 *           恢复时只重做有END的组，因此一组修改要么全部重做，要么全部丢弃
+	 *           可以嵌套，只有最外层的endGroup结束这一组，最好通过LogGroup使用
+	 */
+	void beginGroup() {
+		if (log == nullptr) {
+			return;
+		}
+		if (groupDepth++ == 0) {
+			groupStart = log->CurrentLSN();
+		}
+	}
+	/*
+	 * @函数名endGroup
+	 * 功能:结束beginGroup开始的一组修改
+	 *           比较所有被钉住的写日志的页面和它们的shadow，把修改写成日志，再写一条END
+	 *           组中修改过的页面的pageLSN设为END的位置，由组钉住的页面解除钉住
+	 */
+	void endGroup() {
+		if (log == nullptr || groupDepth <= 0 || --groupDepth > 0) {
+			return;
+		}
+		std::vector<int> frames, held;
+		{
+			std::lock_guard<std::mutex> lock(logLatch);
+			frames = shadowFrames;
+			held.swap(groupHeld);
+		}
+		std::vector<int> changed(held);
+		for (int index : frames) {
+			BufShard& s = shardOf(index);
+			std::lock_guard<std::mutex> guard(s.latch);
+			if (shadow[index] != nullptr && logDiffLocked(s, index)) {
+				changed.push_back(index);
+			}
+		}
+		ull lsn = log->CurrentLSN() == groupStart ? 0 : log->LogEnd();
+		for (int index : changed) {
+			BufShard& s = shardOf(index);
+			std::lock_guard<std::mutex> guard(s.latch);
+			pageLSN[index] = lsn;
+			shadowOpen[index] = false;
+		}
+		for (int index : held) {
+			BufShard& s = shardOf(index);
+			std::lock_guard<std::mutex> guard(s.latch);
+			if (--pinCount[index] == 0) {
+				dropShadowLocked(index);
+				s.replace->unpin(index - s.base);
+				s.last = index;
+			}
+		}
+	}
+	/*
+	 * @函数名logPinned
+	 * 功能:不在组中时，把被钉住的页面上还没有写日志的修改写成一组日志，比如在语句结束时
+	 */
+	void logPinned() {
+		beginGroup();
+		endGroup();
+	}
+	
+	static BufPageManager* Instance(){
+		if(instance == nullptr)
+			instance = new BufPageManager(FileManager::Instance(), framesFromBudget());
+		return instance;
+	}
+};
+#endif
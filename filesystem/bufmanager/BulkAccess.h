@@ -0,0 +1,24 @@
+#ifndef BULK_ACCESS_H
+#define BULK_ACCESS_H
+#include "BufPageManager.h"
+/**
+ * BulkAccess
+ * 批量操作期间让一个文件使用私有环形缓冲区的RAII句柄, 见BufPageManager::startBulk
+ * 构造时开始, 析构时结束, 不能复制
+*/
+class BulkAccess{
+    BufPageManager* bpm;
+    int fileID;
+public:
+    BulkAccess(BufPageManager* bpm, int fileID):bpm(bpm), fileID(fileID){
+        bpm->startBulk(fileID);
+    }
+
+    BulkAccess(const BulkAccess&) = delete;
+    BulkAccess& operator=(const BulkAccess&) = delete;
+
+    ~BulkAccess(){
+        bpm->endBulk(fileID);
+    }
+};
+#endif
@@ -1,55 +1,111 @@
-#ifndef BUF_SEARCH
-#define BUF_SEARCH
-#include "../utils/MyLinkList.h"
-#include "../utils/MyHashMap.h"
-#include "../utils/pagedef.h"
-//template <int CAP_>
-/*
- * FindReplace
- * 提供替换算法接口，这里实现的是栈式LRU算法
- */
-class FindReplace {
-private:
-	MyLinkList* list;
-	int CAP_;
-public:
-	/*
-	 * @函数名free
-	 * @参数index:缓存页面数组中页面的下标
-	 * 功能:将缓存页面数组中第index个页面的缓存空间回收
-	 *           下一次通过find函数寻找替换页面时，直接返回index
-	 */
-	void free(int index) {
-		list->insertFirst(0, index);
-	}
-	/*
-	 * @函数名access
-	 * @参数index:缓存页面数组中页面的下标
-	 * 功能:将缓存页面数组中第index个页面标记为访问
-	 */
-	void access(int index) {
-		list->insert(0, index);
-	}
-	/*
-	 * @函数名find
-	 * 功能:根据替换算法返回缓存页面数组中要被替换页面的下标
-	 */
-	int find() {
-		int index = list->getFirst(0);
-		list->del(index);
-		list->insert(0, index);
-		return index;
-	}
-	/*
-	 * 构造函数
-	 * @参数c:表示缓存页面的容量上限
-	 */
-	FindReplace(int c) {
-		CAP_ = c;
-		list = new MyLinkList(c, 1);
-		for (int i = 0; i < CAP_; ++ i) {
-			list->insert(0, i);
-		}
-	}
-};
-#endif
+#ifndef BUF_SEARCH
+#define BUF_SEARCH
+#include "../utils/MyLinkList.h"
+#include "../utils/MyHashMap.h"
+#include "../utils/pagedef.h"
+#include "Replacer.h"
+//template <int CAP_>
+/*
+ * FindReplace
+ * 提供替换算法接口，这里实现的是栈式LRU算法
+ */
+class FindReplace : public Replacer {
+private:
+	MyLinkList* list;
+	int CAP_;
+public:
+	/*
+	 * @函数名free
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:将缓存页面数组中第index个页面的缓存空间回收
+	 *           下一次通过find函数寻找替换页面时，直接返回index
+	 */
+	void free(int index) override {
+		list->insertFirst(0, index);
+	}
+	/*
+	 * @函数名access
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:将缓存页面数组中第index个页面标记为访问
+	 */
+	void access(int index) override {
+		list->insert(0, index);
+	}
+	/*
+	 * @函数名find
+	 * @参数busy:busy[index]为true的页面暂时不能被替换，跳过它们，可以为nullptr
+	 * 功能:根据替换算法返回缓存页面数组中要被替换页面的下标，页面在load之前保持原来的位置
+	 */
+	int find(const bool* busy) override {
+		int index = list->getFirst(0);
+		while (busy != nullptr && !list->isHead(index) && busy[index]) {
+			index = list->next(index);
+		}
+		if (list->isHead(index)) {
+			return -1;
+		}
+		return index;
+	}
+	/*
+	 * @函数名load
+	 * @参数index:find返回的页面下标
+	 * 功能:第index个页面载入了新的文件页面，把它放到LRU链表尾部
+	 */
+	void load(int index, int /*fileID*/, int /*pageID*/) override {
+		list->del(index);
+		list->insert(0, index);
+	}
+	/*
+	 * @函数名recycle
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:第index个页面被批量操作的环形缓冲区直接复用，把它放到LRU链表头部
+	 */
+	void recycle(int index, int /*fileID*/, int /*pageID*/) override {
+		list->insertFirst(0, index);
+	}
+	/*
+	 * @函数名candidates
+	 * @参数out:用于存储页面下标的数组
+	 * @参数n:最多返回的页面个数
+	 * 功能:从LRU链表头部开始，返回接下来最先被替换的n个页面
+	 * 注意:被free的页面在链表头部，它们不属于任何文件页面，也不会是脏页
+	 */
+	int candidates(int* out, int n) override {
+		int k = 0;
+		for (int index = list->getFirst(0); !list->isHead(index) && k < n; index = list->next(index)) {
+			out[k++] = index;
+		}
+		return k;
+	}
+	/*
+	 * @函数名pin
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:将第index个页面移出LRU链表，被钉住的页面不会被find函数选中
+	 */
+	void pin(int index) override {
+		list->del(index);
+	}
+	/*
+	 * @函数名unpin
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:将第index个页面放回LRU链表，视为刚刚被访问过
+	 */
+	void unpin(int index) override {
+		list->insert(0, index);
+	}
+	/*
+	 * 构造函数
+	 * @参数c:表示缓存页面的容量上限
+	 */
+	FindReplace(int c) {
+		CAP_ = c;
+		list = new MyLinkList(c, 1);
+		for (int i = 0; i < CAP_; ++ i) {
+			list->insert(0, i);
+		}
+	}
+	~FindReplace() {
+		delete list;
+	}
+};
+#endif
@@ -0,0 +1,23 @@
+#ifndef LOG_GROUP_H
+#define LOG_GROUP_H
+#include "BufPageManager.h"
+/**
+ * LogGroup
+ * 一组需要一起重做的修改的RAII句柄, 见BufPageManager::beginGroup
+ * 构造时开始, 析构时结束, 可以嵌套, 不能复制
+*/
+class LogGroup{
+    BufPageManager* bpm;
+public:
+    LogGroup(BufPageManager* bpm):bpm(bpm){
+        bpm->beginGroup();
+    }
+
+    LogGroup(const LogGroup&) = delete;
+    LogGroup& operator=(const LogGroup&) = delete;
+
+    ~LogGroup(){
+        bpm->endGroup();
+    }
+};
+#endif
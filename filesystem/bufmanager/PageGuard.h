@@ -0,0 +1,90 @@
+#ifndef PAGE_GUARD_H
+#define PAGE_GUARD_H
+#include "BufPageManager.h"
+#include <utility>
+/**
+ * PageGuard
+ * 钉住一个缓存页面的RAII句柄, 析构或Release时解除钉住
+ * 持有的页面不会被替换, 因此data和index可以直接使用, 不需要再用getKey和reusePage检查
+ * 只能移动, 不能复制
+*/
+class PageGuard{
+    BufPageManager* bpm = nullptr;
+    int fileID = -1;
+    int pageID = -1;
+    int index = -1;
+    uchar* data = nullptr;
+public:
+    PageGuard(){}
+
+    PageGuard(BufPageManager* bpm, int fileID, int pageID){
+        Fetch(bpm, fileID, pageID);
+    }
+
+    PageGuard(const PageGuard&) = delete;
+    PageGuard& operator=(const PageGuard&) = delete;
+
+    PageGuard(PageGuard&& other){
+        *this = std::move(other);
+    }
+
+    PageGuard& operator=(PageGuard&& other){
+        if(this != &other){
+            Release();
+            bpm = other.bpm;
+            fileID = other.fileID;
+            pageID = other.pageID;
+            index = other.index;
+            data = other.data;
+            other.bpm = nullptr;
+            other.index = -1;
+            other.data = nullptr;
+        }
+        return *this;
+    }
+
+    ~PageGuard(){
+        Release();
+    }
+
+    /**
+     * Pin page (fileID, pageID) and return its buffer
+     * If the guard already holds the page, it's returned without asking bpm, otherwise the old page is unpinned
+    */
+    uchar* Fetch(BufPageManager* bpm, int fileID, int pageID){
+        if(data != nullptr && this->bpm == bpm && this->fileID == fileID && this->pageID == pageID)
+            return data;
+        Release();
+        this->bpm = bpm;
+        this->fileID = fileID;
+        this->pageID = pageID;
+        data = bpm->pinPage(fileID, pageID, index);
+        return data;
+    }
+
+    void Release(){
+        if(data != nullptr){
+            bpm->unpin(index);
+            data = nullptr;
+            index = -1;
+        }
+    }
+
+    void MarkDirty(){
+        if(data != nullptr)
+            bpm->markDirty(index);
+    }
+
+    bool Holds(int fileID, int pageID) const {
+        return data != nullptr && this->fileID == fileID && this->pageID == pageID;
+    }
+
+    uchar* Data() const {
+        return data;
+    }
+
+    int Index() const {
+        return index;
+    }
+};
+#endif
@@ -0,0 +1,72 @@
+#ifndef REPLACER_H
+#define REPLACER_H
+/*
+ * Replacer
+ * 替换算法的公共接口，BufPageManager只通过这个接口和替换算法交互
+ * 缓存页面用它在缓存页面数组中的下标index表示
+ * 具体实现见FindReplace(栈式LRU)和TwoQReplace(2Q)
+ */
+class Replacer {
+public:
+	/*
+	 * @函数名free
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:第index个页面被清空，下一次find时最先返回它
+	 */
+	virtual void free(int index) = 0;
+	/*
+	 * @函数名access
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:第index个页面在hash表中被找到，标记为访问
+	 */
+	virtual void access(int index) = 0;
+	/*
+	 * @函数名find
+	 * @参数busy:busy[index]为true的页面(正在被写回)暂时不能被替换，跳过它们，但它们在队列中的位置不变，可以为nullptr
+	 * 功能:根据替换算法选出要被替换的页面，不改变替换算法的状态
+	 *           调用者写回选出的脏页成功后才调用load，写回失败时不调用
+	 * 返回:页面的下标，所有页面都被钉住或者busy时返回-1
+	 */
+	virtual int find(const bool* busy) = 0;
+	/*
+	 * @函数名load
+	 * @参数index:find返回的页面下标
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 功能:第index个页面载入了文件页面(fileID,pageID)，成为最新载入的页面
+	 *           记录被替换页面历史的算法(比如2Q)需要用到(fileID,pageID)
+	 */
+	virtual void load(int index, int fileID, int pageID) = 0;
+	/*
+	 * @函数名recycle
+	 * @参数index:缓存页面数组中页面的下标，没有被钉住也不是busy
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 功能:第index个页面被批量操作的环形缓冲区直接复用，载入了(fileID,pageID)，代替find和load
+	 *           这个页面很可能不会再被访问，应当最先被替换，记录历史的算法也不能把它当作再次访问
+	 */
+	virtual void recycle(int index, int fileID, int pageID) = 0;
+	/*
+	 * @函数名pin
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:第index个页面被钉住，unpin之前find不能返回它，也不会对它调用access和free
+	 */
+	virtual void pin(int index) = 0;
+	/*
+	 * @函数名unpin
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:第index个页面上最后一个钉住被解除，重新可以被find选中
+	 */
+	virtual void unpin(int index) = 0;
+	/*
+	 * @函数名candidates
+	 * @参数out:用于存储页面下标的数组
+	 * @参数n:最多返回的页面个数
+	 * 功能:大致按find替换的顺序返回接下来要被替换的页面，后台线程先写回它们
+	 *           不包括被钉住的页面，可能包括空的页面
+	 * 返回:存入out的页面个数
+	 */
+	virtual int candidates(int* out, int n) = 0;
+	virtual ~Replacer() {}
+};
+#endif
@@ -0,0 +1,194 @@
+#ifndef TWO_Q_REPLACE
+#define TWO_Q_REPLACE
+#include "../utils/MyLinkList.h"
+#include "../utils/pagedef.h"
+#include "Replacer.h"
+#include <unordered_map>
+#include <deque>
+/*
+ * TwoQReplace
+ * 2Q替换算法(Johnson & Shasha, 1994)，对顺序扫描有抵抗力
+ * 只被访问过一次的页面进入先进先出队列A1in，被A1in淘汰时其键值留在幽灵队列A1out中
+ * 如果一个页面在A1out中时再次被载入，说明它是热页面，进入LRU队列Am
+ * 一次全表扫描只会冲刷A1in，不会把Am中的B+树节点等热页面挤出缓存
+ * 被钉住的页面暂存在PINNED链表中，解除后回到原来的队列
+ */
+class TwoQReplace : public Replacer {
+private:
+	// MyLinkList中的链表编号
+	static const int FREE = 0, A1IN = 1, AM = 2, PINNED = 3;
+	MyLinkList* list;
+	int CAP_;
+	// A1in和A1out的大小上限
+	int kin, kout;
+	int size[4];
+	// 页面所在的链表
+	uchar* where;
+	// 被钉住的页面原来所在的链表
+	uchar* from;
+	// 页面中的(fileID,pageID)，被淘汰时放入A1out
+	ull* keys;
+	// A1out，键值 -> 它在ghostQueue中最新一项的序号
+	std::unordered_map<ull, ull> ghosts;
+	std::deque<std::pair<ull, ull>> ghostQueue;
+	ull ghostSeq = 0;
+
+	static ull packKey(int fileID, int pageID) {
+		return ((ull)(uint)fileID << 32) | (uint)pageID;
+	}
+	void moveTo(int listID, int index) {
+		size[where[index]]--;
+		where[index] = listID;
+		size[listID]++;
+		list->insert(listID, index);
+	}
+	void remember(ull key) {
+		ghosts[key] = ++ghostSeq;
+		ghostQueue.push_back(std::make_pair(key, ghostSeq));
+		// 幽灵页面被命中时队列中留下过期的项，所以两个大小都要限制
+		while ((int)ghosts.size() > kout || (int)ghostQueue.size() > (kout << 1)) {
+			std::pair<ull, ull> oldest = ghostQueue.front();
+			ghostQueue.pop_front();
+			auto it = ghosts.find(oldest.first);
+			if (it != ghosts.end() && it->second == oldest.second)
+				ghosts.erase(it);
+		}
+	}
+	int firstNotBusy(int listID, const bool* busy) {
+		int index = list->getFirst(listID);
+		while (busy != nullptr && !list->isHead(index) && busy[index])
+			index = list->next(index);
+		return list->isHead(index) ? -1 : index;
+	}
+public:
+	/*
+	 * @函数名free
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:页面放到空链表的头部，下一次find时最先返回
+	 */
+	void free(int index) override {
+		size[where[index]]--;
+		where[index] = FREE;
+		size[FREE]++;
+		list->insertFirst(FREE, index);
+	}
+	/*
+	 * @函数名access
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:Am中的页面移到LRU队列尾部，A1in中的页面不变，这样的访问通常来自同一次扫描
+	 */
+	void access(int index) override {
+		if (where[index] == AM)
+			list->insert(AM, index);
+	}
+	/*
+	 * @函数名find
+	 * @参数busy:busy[index]为true的页面暂时不能被替换，可以为nullptr
+	 * 功能:优先返回空的页面(空的页面没有数据，不会是busy)，A1in超过kin或者Am为空时从A1in选，否则从Am选
+	 * 返回:页面的下标，都不能被替换时返回-1
+	 */
+	int find(const bool* busy) override {
+		int index;
+		if (size[FREE] > 0)
+			index = list->getFirst(FREE);
+		else {
+			int first = (size[A1IN] > kin || size[AM] == 0) ? A1IN : AM;
+			index = firstNotBusy(first, busy);
+			if (index == -1)
+				index = firstNotBusy(first == A1IN ? AM : A1IN, busy);
+		}
+		return index;
+	}
+	/*
+	 * @函数名load
+	 * @参数index:find返回的页面下标
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 功能:从A1in淘汰的键值放入A1out，页面进入A1in，新的键值在A1out中时进入Am
+	 */
+	void load(int index, int fileID, int pageID) override {
+		if (where[index] == A1IN)
+			remember(keys[index]);
+		moveTo(A1IN, index);
+		ull key = packKey(fileID, pageID);
+		keys[index] = key;
+		auto it = ghosts.find(key);
+		if (it != ghosts.end()) {
+			ghosts.erase(it);
+			moveTo(AM, index);
+		}
+	}
+	/*
+	 * @函数名recycle
+	 * @参数index:缓存页面数组中页面的下标
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 功能:页面放到A1in头部，不查A1out，批量扫描不会把页面提升到Am
+	 */
+	void recycle(int index, int fileID, int pageID) override {
+		keys[index] = packKey(fileID, pageID);
+		size[where[index]]--;
+		where[index] = A1IN;
+		size[A1IN]++;
+		list->insertFirst(A1IN, index);
+	}
+	/*
+	 * @函数名candidates
+	 * @参数out:用于存储页面下标的数组
+	 * @参数n:最多返回的页面个数
+	 * 功能:先返回A1in中的页面，再返回Am中的，A1in超过kin时find优先从A1in替换
+	 * 返回:存入out的页面个数
+	 */
+	int candidates(int* out, int n) override {
+		int k = 0;
+		for (int listID = A1IN; listID <= AM; ++listID)
+			for (int index = list->getFirst(listID); !list->isHead(index) && k < n; index = list->next(index))
+				out[k++] = index;
+		return k;
+	}
+	/*
+	 * @函数名pin
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:页面移到PINNED链表，记下它原来所在的队列
+	 */
+	void pin(int index) override {
+		from[index] = where[index];
+		moveTo(PINNED, index);
+	}
+	/*
+	 * @函数名unpin
+	 * @参数index:缓存页面数组中页面的下标
+	 * 功能:页面回到原来队列的尾部，长时间被钉住的页面不会在解除后马上被替换
+	 */
+	void unpin(int index) override {
+		moveTo(from[index], index);
+	}
+	/*
+	 * 构造函数
+	 * @参数c:缓存页面的容量上限
+	 * A1in占缓存的1/4，A1out记录缓存容量一半的幽灵页面，取论文推荐的参数
+	 */
+	TwoQReplace(int c) {
+		CAP_ = c;
+		kin = c >> 2;
+		kout = c >> 1;
+		list = new MyLinkList(c, 4);
+		where = new uchar[c];
+		from = new uchar[c];
+		keys = new ull[c];
+		size[FREE] = c;
+		size[A1IN] = size[AM] = size[PINNED] = 0;
+		for (int i = 0; i < CAP_; ++ i) {
+			where[i] = from[i] = FREE;
+			keys[i] = 0;
+			list->insert(FREE, i);
+		}
+	}
+	~TwoQReplace() {
+		delete list;
+		delete[] where;
+		delete[] from;
+		delete[] keys;
+	}
+};
+#endif
@@ -0,0 +1,222 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include "../utils/pagedef.h"
+#if FILE_USE_IO_URING && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define ASYNC_IO_URING 1
+#else
+#define ASYNC_IO_URING 0
+#endif
+/*
+ * AsyncRequest
+ * 一次向量读写，读写文件fd中从offset开始的内容
+ */
+struct AsyncRequest {
+	int fd;
+	bool write;
+	const struct iovec* iov;
+	int iovcnt;
+	off_t offset;
+};
+/*
+ * AsyncIO
+ * 批量提交读写请求，等待它们全部完成
+ * 内核支持io_uring时，一批请求通过一次io_uring_enter提交，同时在设备上进行
+ * 不支持时(编译时FILE_USE_IO_URING为0、内核太旧或被seccomp禁止)退回逐个调用preadv/pwritev
+ * 一个AsyncIO同一时刻只能被一个线程使用，每个需要批量读写的线程应该有自己的AsyncIO
+ * 只完成一次系统调用，不处理读写了一部分的情况，由调用者(FileManager)补齐
+ */
+class AsyncIO {
+private:
+	int depth;
+#if ASYNC_IO_URING
+	int ringFd;
+	// 提交队列
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned* sqMask;
+	unsigned* sqArray;
+	struct io_uring_sqe* sqes;
+	// 完成队列
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned* cqMask;
+	struct io_uring_cqe* cqes;
+	void* sqRing;
+	void* cqRing;
+	size_t sqRingSize;
+	size_t cqRingSize;
+	size_t sqesSize;
+	bool setup(unsigned entries) {
+		struct io_uring_params p;
+		memset(&p, 0, sizeof(p));
+		ringFd = (int)syscall(__NR_io_uring_setup, entries, &p);
+		if (ringFd < 0) {
+			return false;
+		}
+		sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+		if (p.features & IORING_FEAT_SINGLE_MMAP) {
+			sqRingSize = cqRingSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+		}
+		sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+		if (sqRing == MAP_FAILED) {
+			::close(ringFd);
+			return false;
+		}
+		cqRing = sqRing;
+		if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+			cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+			if (cqRing == MAP_FAILED) {
+				munmap(sqRing, sqRingSize);
+				::close(ringFd);
+				return false;
+			}
+		}
+		sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+		sqes = (struct io_uring_sqe*)mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+		if (sqes == MAP_FAILED) {
+			if (cqRing != sqRing) {
+				munmap(cqRing, cqRingSize);
+			}
+			munmap(sqRing, sqRingSize);
+			::close(ringFd);
+			return false;
+		}
+		char* sq = (char*)sqRing;
+		sqHead = (unsigned*)(sq + p.sq_off.head);
+		sqTail = (unsigned*)(sq + p.sq_off.tail);
+		sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+		sqArray = (unsigned*)(sq + p.sq_off.array);
+		char* cq = (char*)cqRing;
+		cqHead = (unsigned*)(cq + p.cq_off.head);
+		cqTail = (unsigned*)(cq + p.cq_off.tail);
+		cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+		cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+		depth = (int)p.sq_entries;
+		return true;
+	}
+	/*
+	 * 提交reqs中的n个请求(n不超过depth)并等待它们全部完成
+	 * io_uring_enter出错时返回false
+	 */
+	bool runRing(const AsyncRequest* reqs, int n, ssize_t* res) {
+		unsigned tail = *sqTail;
+		for (int i = 0; i < n; ++ i) {
+			unsigned k = tail & *sqMask;
+			struct io_uring_sqe* sqe = &sqes[k];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = reqs[i].write ? IORING_OP_WRITEV : IORING_OP_READV;
+			sqe->fd = reqs[i].fd;
+			sqe->addr = (unsigned long long)reqs[i].iov;
+			sqe->len = reqs[i].iovcnt;
+			sqe->off = reqs[i].offset;
+			sqe->user_data = i;
+			sqArray[k] = k;
+			++ tail;
+		}
+		// 内核在看到新的tail之前必须能看到填好的sqe
+		__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+		int submitted = 0, completed = 0;
+		while (completed < n) {
+			int ret = (int)syscall(__NR_io_uring_enter, ringFd, n - submitted, n - completed, IORING_ENTER_GETEVENTS, NULL, 0);
+			if (ret < 0) {
+				if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+					continue;
+				}
+				printf("In AsyncIO::run, io_uring_enter failed: %s\n", strerror(errno));
+				return false;
+			}
+			submitted += ret;
+			unsigned head = *cqHead;
+			unsigned cqTailNow = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+			while (head != cqTailNow) {
+				struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+				res[cqe->user_data] = cqe->res;
+				++ completed;
+				++ head;
+			}
+			__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+		}
+		return true;
+	}
+#endif
+	static void runSync(const AsyncRequest* reqs, int n, ssize_t* res) {
+		for (int i = 0; i < n; ++ i) {
+			ssize_t ret;
+			do {
+				if (reqs[i].write) {
+					ret = pwritev(reqs[i].fd, reqs[i].iov, reqs[i].iovcnt, reqs[i].offset);
+				} else {
+					ret = preadv(reqs[i].fd, reqs[i].iov, reqs[i].iovcnt, reqs[i].offset);
+				}
+			} while (ret < 0 && errno == EINTR);
+			res[i] = ret < 0 ? -errno : ret;
+		}
+	}
+	bool uring;
+public:
+	/*
+	 * 构造函数
+	 * @参数entries:同时在设备上的请求数上限，io_uring不可用时没有意义
+	 */
+	AsyncIO(int entries = FILE_IO_DEPTH) {
+		depth = entries;
+		uring = false;
+#if ASYNC_IO_URING
+		uring = setup(entries);
+#endif
+	}
+	/*
+	 * @函数名usingUring
+	 * 返回:是否在使用io_uring，为false时run逐个同步读写
+	 */
+	bool usingUring() {
+		return uring;
+	}
+	/*
+	 * @函数名run
+	 * @参数reqs:n个请求
+	 * @参数res:函数返回时，res[i]为第i个请求读写的字节数，出错时为-errno
+	 * 功能:提交n个请求并等待它们全部完成，请求之间没有顺序保证
+	 */
+	void run(const AsyncRequest* reqs, int n, ssize_t* res) {
+#if ASYNC_IO_URING
+		for (int i = 0; uring && i < n; i += depth) {
+			int m = n - i < depth ? n - i : depth;
+			if (!runRing(reqs + i, m, res + i)) {
+				// io_uring出错后退回同步读写，这一批请求重新做一次
+				uring = false;
+				runSync(reqs + i, m, res + i);
+				runSync(reqs + i + m, n - i - m, res + i + m);
+				return;
+			}
+		}
+		if (uring) {
+			return;
+		}
+#endif
+		runSync(reqs, n, res);
+	}
+	~AsyncIO() {
+#if ASYNC_IO_URING
+		if (uring) {
+			munmap(sqes, sqesSize);
+			if (cqRing != sqRing) {
+				munmap(cqRing, cqRingSize);
+			}
+			munmap(sqRing, sqRingSize);
+			::close(ringFd);
+		}
+#endif
+	}
+};
+#endif
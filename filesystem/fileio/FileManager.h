@@ -1,147 +1,774 @@
-#ifndef FILE_MANAGER
-#define FILE_MANAGER
-#include <string>
-#include <stdio.h>
-#include <iostream>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <unistd.h>
-#include <fcntl.h>
-
-#include "../utils/pagedef.h"
-#include "../utils/MyBitMap.h"
-//#include "../MyLinkList.h"
-using namespace std;
-class FileManager {
-private:
-	//FileTable* ftable;
-	int fd[MAX_FILE_NUM];
-	MyBitMap* fm;
-	MyBitMap* tm;
-	int _createFile(const char* name) {
-		FILE* f = fopen(name, "a+");
-		if (f == NULL) {
-			cout << "fail" << endl;
-			return -1;
-		}
-		fclose(f);
-		return 0;
-	}
-	int _openFile(const char* name, int fileID) {
-		int f = open(name, O_RDWR);
-		if (f == -1) {
-			return -1;
-		}
-		fd[fileID] = f;
-		return 0;
-	}
-	static FileManager *instance;
-	FileManager() {
-		MyBitMap::initConst();
-		fm = new MyBitMap(MAX_FILE_NUM, 1);
-		tm = new MyBitMap(MAX_TYPE_NUM, 1);
-	}
-public:
-	/*
-	 * FilManager构造函数
-	 */
-	/*
-	 * @函数名writePage
-	 * @参数fileID:文件id，用于区别已经打开的文件
-	 * @参数pageID:文件的页号
-	 * @参数buf:存储信息的缓存(4字节无符号整数数组)
-	 * @参数off:偏移量
-	 * 功能:将buf+off开始的2048个四字节整数(8kb信息)写入fileID和pageID指定的文件页中
-	 * 返回:成功操作返回0
-	 */
-	int writePage(int fileID, int pageID, BufType buf, int off) {
-		int f = fd[fileID];
-		off_t offset = pageID;
-		offset = (offset << PAGE_SIZE_IDX);
-		off_t error = lseek(f, offset, SEEK_SET);
-		if (error != offset) {
-			return -1;
-		}
-		BufType b = buf + off;
-		error = write(f, (void*) b, PAGE_SIZE);
-		return 0;
-	}
-	/*
-	 * @函数名readPage
-	 * @参数fileID:文件id，用于区别已经打开的文件
-	 * @参数pageID:文件页号
-	 * @参数buf:存储信息的缓存(4字节无符号整数数组)
-	 * @参数off:偏移量
-	 * 功能:将fileID和pageID指定的文件页中2048个四字节整数(8kb)读入到buf+off开始的内存中
-	 * 返回:成功操作返回0
-	 */
-	int readPage(int fileID, int pageID, BufType buf, int off) {
-		//int f = fd[fID[type]];
-		int f = fd[fileID];
-		off_t offset = pageID;
-		offset = (offset << PAGE_SIZE_IDX);
-		off_t error = lseek(f, offset, SEEK_SET);
-		if (error != offset) {
-			return -1;
-		}
-		BufType b = buf + off;
-		error = read(f, (void*) b, PAGE_SIZE);
-		return 0;
-	}
-	/*
-	 * @函数名closeFile
-	 * @参数fileID:用于区别已经打开的文件
-	 * 功能:关闭文件
-	 * 返回:操作成功，返回0
-	 */
-	int closeFile(int fileID) {
-		fm->setBit(fileID, 1);
-		int f = fd[fileID];
-		close(f);
-		return 0;
-	}
-	/*
-	 * @函数名createFile
-	 * @参数name:文件名
-	 * 功能:新建name指定的文件名
-	 * 返回:操作成功，返回true
-	 */
-	bool createFile(const char* name) {
-		return _createFile(name) == 0;
-		// return true;
-	}
-	/*
-	 * @函数名openFile
-	 * @参数name:文件名
-	 * @参数fileID:函数返回时，如果成功打开文件，那么为该文件分配一个id，记录在fileID中
-	 * 功能:打开文件,如果文件不存在也不会创建，而是返回false
-	 * 返回:如果成功打开，在fileID中存储为该文件分配的id，返回true，否则返回false
-	 */
-	bool openFile(const char* name, int& fileID) {
-		fileID = fm->findLeftOne();
-		fm->setBit(fileID, 0);
-		return _openFile(name, fileID) == 0;
-		// return true;
-	}
-	int newType() {
-		int t = tm->findLeftOne();
-		tm->setBit(t, 0);
-		return t;
-	}
-	void closeType(int typeID) {
-		tm->setBit(typeID, 1);
-	}
-	void shutdown() {
-		delete tm;
-		delete fm;
-	}
-	~FileManager() {
-		this->shutdown();
-	}
-	static FileManager* Instance(){
-		if(instance == nullptr)
-			instance = new FileManager();
-		return instance;
-	}
-};
-#endif
+#ifndef FILE_MANAGER
+#define FILE_MANAGER
+#include <string>
+#include <stdio.h>
+#include <iostream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "../utils/pagedef.h"
+#include "../utils/MyBitMap.h"
+#include "AsyncIO.h"
+#include "PageChecksums.h"
+#include "PageCompression.h"
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+//#include "../MyLinkList.h"
+using namespace std;
+/*
+ * PageRun
+ * 文件中一段连续的页面，bufs[i]对应第pageID+i页，批量读写的单位
+ * 读写结束后result为0表示成功，-1表示失败，FILE_PAGE_CORRUPT表示读出的页面中有损坏的
+ */
+struct PageRun {
+	int fileID;
+	int pageID;
+	int n;
+	BufType* bufs;
+	int result;
+};
+class FileManager {
+private:
+	//FileTable* ftable;
+	int fd[MAX_FILE_NUM];
+	/*
+	 * 只读打开的文件被整个映射到内存中，mapped[fileID]为映射的首地址，没有映射时为NULL
+	 * mappedPages[fileID]为打开时文件的页数，之后的页面读出来全是0，都指向zeroPage
+	 */
+	uchar* mapped[MAX_FILE_NUM];
+	int mappedPages[MAX_FILE_NUM];
+	uchar* zeroPage;
+	// 以读写方式打开的文件是否使用O_DIRECT
+	bool directIO;
+	// 每个文件的fd是否带O_DIRECT，文件系统不支持时只有这个文件退回到页缓存
+	bool direct[MAX_FILE_NUM];
+	/*
+	 * written[fileID]为true时文件或它的校验和文件在上次同步之后被写过，见syncFiles
+	 * syncLatch保证同步时fd不会被closeFile关闭
+	 */
+	std::atomic<bool> written[MAX_FILE_NUM];
+	std::mutex syncLatch;
+	// 每个文件的页面校验和，写页面之前记录，通过readPage和readRuns读出时检查，只读映射中的页面不检查
+	PageChecksums sums[MAX_FILE_NUM];
+	// 检查出的损坏页面数
+	std::atomic<ull> corrupt;
+	/*
+	 * 页面压缩，见setCompression
+	 * compressed[fileID]为true时写入的页面先压缩，压缩后按blockSize[fileID](文件系统块的大小)取整，页面剩下的部分打洞释放
+	 * 文件系统不支持打洞时punchHole为false，之后页面都按原样写
+	 * 只读映射中被压缩的页面在第一次访问时解压到inflated[fileID]中，closeFile时释放
+	 */
+	bool compressed[MAX_FILE_NUM];
+	int blockSize[MAX_FILE_NUM];
+	std::atomic<bool> punchHole;
+	std::map<int, uchar*> inflated[MAX_FILE_NUM];
+	std::mutex inflateLatch;
+	/*
+	 * 按区段预先分配，见_reserve
+	 * allocEnd[fileID]为文件已经分配空间的位置(字节)，打开时由文件大小和占用的块数得到
+	 * extentMax为区段大小的上限，为0时不预先分配
+	 */
+	std::atomic<ll> allocEnd[MAX_FILE_NUM];
+	ll extentMax;
+	std::mutex extentLatch;
+	MyBitMap* fm;
+	MyBitMap* tm;
+	int _createFile(const char* name) {
+		// 新建的文件不能沿用之前同名文件留下的校验和
+		if (access(name, F_OK) != 0) {
+			unlink(PageChecksums::pathOf(name).data());
+		}
+		FILE* f = fopen(name, "a+");
+		if (f == NULL) {
+			cout << "fail" << endl;
+			return -1;
+		}
+		fclose(f);
+		return 0;
+	}
+	int _openFile(const char* name, int fileID, bool readOnly) {
+		int f;
+		direct[fileID] = false;
+		written[fileID] = false;
+		if (readOnly || !directIO) {
+			f = open(name, readOnly ? O_RDONLY : O_RDWR);
+		} else {
+			f = open(name, O_RDWR | O_DIRECT);
+			if (f == -1 && errno == EINVAL) {
+				// 文件系统不支持O_DIRECT(比如tmpfs)，这个文件经过页缓存读写
+				printf("In FileManager::openFile, O_DIRECT is not supported for %s, falling back to buffered I/O\n", name);
+				f = open(name, O_RDWR);
+			} else if (f != -1) {
+				direct[fileID] = true;
+			}
+		}
+		if (f == -1) {
+			return -1;
+		}
+		fd[fileID] = f;
+		mapped[fileID] = NULL;
+		mappedPages[fileID] = 0;
+		compressed[fileID] = false;
+		struct stat st;
+		bool statOk = fstat(f, &st) == 0;
+		blockSize[fileID] = statOk && st.st_blksize > 512 ? st.st_blksize : 512;
+		if (direct[fileID] && blockSize[fileID] < FILE_DIRECT_ALIGN) {
+			blockSize[fileID] = FILE_DIRECT_ALIGN;
+		}
+		// 之前预先分配过的空间在文件末尾之后，只计入占用的块数
+		allocEnd[fileID] = statOk ? std::max((ll)st.st_size, (ll)st.st_blocks * 512) : 0;
+		if (readOnly) {
+			_mapFile(fileID);
+		}
+		if (!sums[fileID].open(name, readOnly)) {
+			printf("In FileManager::openFile, cannot open the page checksums of %s: %s, its pages are not checked\n", name, strerror(errno));
+		}
+		return 0;
+	}
+	/*
+	 * 处理刚读出的第pageID页:写入时被压缩的页面原地解压，再检查校验和，损坏时计数并返回false
+	 */
+	bool _loaded(int fileID, int pageID, void* page) {
+		if (PageCompression::load(sums[fileID], pageID, page, page, compressed[fileID]) < 0) {
+			++ corrupt;
+			printf("In FileManager::readPage, page %d of file %d is corrupted, it cannot be decompressed\n", pageID, fileID);
+			return false;
+		}
+		if (sums[fileID].verify(pageID, page)) {
+			return true;
+		}
+		++ corrupt;
+		printf("In FileManager::readPage, page %d of file %d is corrupted, its checksum does not match\n", pageID, fileID);
+		return false;
+	}
+	/*
+	 * 压缩并写入压缩的文件中的一个页面，压缩后不能少占用至少一个块时按原样写
+	 * 写之前记录页面的校验和，同时记下它是否被压缩
+	 * 页面在文件末尾之后时写满整个页面再打洞，文件大小要包括这个页面，否则pageCount会少算
+	 * 打洞失败时页面后面的部分仍是旧的内容，读的时候只解压Frame中记录的长度，不影响正确性
+	 */
+	int _writeCompressed(int fileID, int pageID, BufType page) {
+		int f = fd[fileID];
+		off_t offset = (off_t)pageID << PAGE_SIZE_IDX;
+		int block = blockSize[fileID];
+		uint stored[PAGE_INT_NUM];
+		uchar* bytes = (uchar*)stored;
+		int len = punchHole ? PageCompression::compress(page, bytes, PAGE_SIZE - block) : 0;
+		if (sums[fileID].record(pageID, &page, 1, 0, len > 0) != 0) {
+			printf("In FileManager::writePage, cannot write the checksum of page %d of file %d: %s\n", pageID, fileID, strerror(errno));
+			return -1;
+		}
+		struct iovec iov;
+		if (len == 0) {
+			iov.iov_base = (void*) page;
+			iov.iov_len = PAGE_SIZE;
+			return _rw(fileID, &iov, 1, offset, true);
+		}
+		int used = (len + block - 1) / block * block;
+		memset(bytes + len, 0, PAGE_SIZE - len);
+		struct stat st;
+		bool extend = fstat(f, &st) != 0 || st.st_size < offset + PAGE_SIZE;
+		iov.iov_base = (void*) bytes;
+		iov.iov_len = extend ? PAGE_SIZE : used;
+		if (_rw(fileID, &iov, 1, offset, true) != 0) {
+			return -1;
+		}
+		if (fallocate(f, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset + used, PAGE_SIZE - used) != 0
+			&& (errno == EOPNOTSUPP || errno == ENOSYS)) {
+			printf("In FileManager::writePage, the file system cannot punch holes, pages are no longer compressed\n");
+			punchHole = false;
+		}
+		return 0;
+	}
+	/*
+	 * 写文件中end(字节)之前的部分前调用，end超过已经分配的位置时用fallocate分配下一个区段
+	 * 区段的大小和已经分配的大小相同，在FILE_EXTENT_MIN和extentMax之间，并且至少到end，按FILE_EXTENT_MIN取整
+	 *   大量导入时文件按越来越大的连续区段增长，不用每写一页都由文件系统分配一次块
+	 * 使用FALLOC_FL_KEEP_SIZE，文件大小不变，pageCount仍然是写过的页数；预先分配的空间在删除文件时释放
+	 * 压缩的文件靠打洞节省空间，不预先分配
+	 * 分配失败(比如磁盘空间不够)时不报错，由之后的写入自己分配
+	 */
+	void _reserve(int fileID, off_t end) {
+		if (extentMax == 0 || compressed[fileID] || end <= allocEnd[fileID]) {
+			return;
+		}
+		std::lock_guard<std::mutex> guard(extentLatch);
+		ll from = allocEnd[fileID];
+		if (end <= from || extentMax == 0) {
+			return;
+		}
+		ll size = std::min(std::max(from, (ll)FILE_EXTENT_MIN), extentMax);
+		ll to = std::max(from + size, (ll)end);
+		to = (to + FILE_EXTENT_MIN - 1) / FILE_EXTENT_MIN * FILE_EXTENT_MIN;
+		if (fallocate(fd[fileID], FALLOC_FL_KEEP_SIZE, from, to - from) != 0 && (errno == EOPNOTSUPP || errno == ENOSYS)) {
+			printf("In FileManager::writePage, the file system cannot preallocate, files grow page by page\n");
+			extentMax = 0;
+			return;
+		}
+		allocEnd[fileID] = to;
+	}
+	/*
+	 * 只读映射中写入时被压缩的页面，解压后的副本放在inflated中，没有压缩时返回p，解压失败时返回NULL
+	 */
+	BufType _inflateMapped(int fileID, int pageID, uchar* p) {
+		std::lock_guard<std::mutex> guard(inflateLatch);
+		auto it = inflated[fileID].find(pageID);
+		if (it != inflated[fileID].end()) {
+			return (BufType)(it->second != NULL ? it->second : p);
+		}
+		uchar* page = (uchar*)malloc(PAGE_SIZE);
+		int ret = PageCompression::load(sums[fileID], pageID, p, page, compressed[fileID]);
+		if (ret < 0) {
+			// 之后通过缓存读，由readPage报告损坏
+			free(page);
+			return NULL;
+		}
+		if (ret == 0) {
+			free(page);
+			page = NULL;
+		}
+		inflated[fileID][pageID] = page;
+		return (BufType)(page != NULL ? page : p);
+	}
+	/*
+	 * 把只读打开的文件整个映射到内存中，映射失败时仍然通过缓存读
+	 * 页面大多是B+树节点和零散的记录，默认不让内核预读，顺序访问由缓存管理器用adviseWillNeed提示
+	 */
+	void _mapFile(int fileID) {
+		struct stat st;
+		if (fstat(fd[fileID], &st) != 0 || st.st_size < PAGE_SIZE) {
+			return;
+		}
+		int pages = (int)(st.st_size >> PAGE_SIZE_IDX);
+		void* p = mmap(NULL, (size_t)pages << PAGE_SIZE_IDX, PROT_READ, MAP_SHARED, fd[fileID], 0);
+		if (p == MAP_FAILED) {
+			printf("In FileManager::openFile, cannot map file %d: %s, reading through the buffer\n", fileID, strerror(errno));
+			return;
+		}
+		madvise(p, (size_t)pages << PAGE_SIZE_IDX, MADV_RANDOM);
+		mapped[fileID] = (uchar*)p;
+		mappedPages[fileID] = pages;
+	}
+	/*
+	 * 跳过iov开头的done个字节，iov和n随之改变
+	 */
+	static void _advance(struct iovec*& iov, int& n, size_t done) {
+		while (n > 0 && done >= iov->iov_len) {
+			done -= iov->iov_len;
+			++ iov;
+			-- n;
+		}
+		if (n > 0) {
+			iov->iov_base = (char*)iov->iov_base + done;
+			iov->iov_len -= done;
+		}
+	}
+	/*
+	 * 在文件f的offset处读写iov中的n段数据，已经完成了done个字节
+	 * 读写了一部分时继续读写剩下的部分，被信号打断时重试
+	 * 读到文件末尾时，之后的部分还没有被写过，用0填充
+	 * iov的内容会被修改
+	 * 返回:成功返回0，失败返回-1，errno说明原因
+	 */
+	static int _rwAll(int f, struct iovec* iov, int n, off_t offset, bool write, size_t done = 0) {
+		_advance(iov, n, done);
+		offset += done;
+		while (n > 0) {
+			ssize_t ret = write ? pwritev(f, iov, n, offset) : preadv(f, iov, n, offset);
+			if (ret < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				return -1;
+			}
+			if (ret == 0) {
+				if (write) {
+					errno = EIO;
+					return -1;
+				}
+				for (int i = 0; i < n; ++ i) {
+					memset(iov[i].iov_base, 0, iov[i].iov_len);
+				}
+				return 0;
+			}
+			offset += ret;
+			_advance(iov, n, ret);
+		}
+		return 0;
+	}
+	static bool _aligned(const struct iovec* iov, int n) {
+		for (int i = 0; i < n; ++ i) {
+			if (((size_t)iov[i].iov_base & (FILE_DIRECT_ALIGN - 1)) != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+	/*
+	 * 与_rwAll相同，读写fileID指定的文件，但它使用O_DIRECT时，没有对齐的iov先复制到对齐的临时缓存中，整个请求重新读写
+	 * 缓存管理器的页面都是对齐的，只有建表时写表头之类的少数读写需要复制
+	 */
+	int _rw(int fileID, struct iovec* iov, int n, off_t offset, bool write, size_t done = 0) {
+		int f = fd[fileID];
+		if (write) {
+			written[fileID] = true;
+		}
+		if (!direct[fileID] || _aligned(iov, n)) {
+			return _rwAll(f, iov, n, offset, write, done);
+		}
+		size_t total = 0;
+		for (int i = 0; i < n; ++ i) {
+			total += iov[i].iov_len;
+		}
+		void* bounce;
+		if (posix_memalign(&bounce, FILE_DIRECT_ALIGN, total) != 0) {
+			errno = ENOMEM;
+			return -1;
+		}
+		struct iovec one;
+		one.iov_base = bounce;
+		one.iov_len = total;
+		size_t pos = 0;
+		if (write) {
+			for (int i = 0; i < n; pos += iov[i].iov_len, ++ i) {
+				memcpy((char*)bounce + pos, iov[i].iov_base, iov[i].iov_len);
+			}
+		}
+		int ret = _rwAll(f, &one, 1, offset, write);
+		if (ret == 0 && !write) {
+			for (int i = 0; i < n; pos += iov[i].iov_len, ++ i) {
+				memcpy(iov[i].iov_base, (char*)bounce + pos, iov[i].iov_len);
+			}
+		}
+		free(bounce);
+		return ret;
+	}
+	int _ioRuns(PageRun* runs, int count, AsyncIO* aio, bool write) {
+		int total = 0;
+		for (int i = 0; i < count; ++ i) {
+			total += runs[i].n;
+		}
+		std::vector<struct iovec> iovs(total);
+		std::vector<AsyncRequest> reqs(count);
+		std::vector<ssize_t> res(count, 0);
+		// 校验和写失败的段不写，压缩的文件逐页同步写，由_writeCompressed记录校验和
+		std::vector<bool> skip(count, false);
+		for (int i = 0, k = 0; i < count; k += runs[i].n, ++ i) {
+			if (write) {
+				written[runs[i].fileID] = true;
+			}
+			bool each = write && compressed[runs[i].fileID];
+			if (write && !each && sums[runs[i].fileID].record(runs[i].pageID, runs[i].bufs, runs[i].n) != 0) {
+				skip[i] = true;
+			}
+			if (write && !skip[i]) {
+				_reserve(runs[i].fileID, (off_t)(runs[i].pageID + runs[i].n) << PAGE_SIZE_IDX);
+			}
+			for (int j = 0; j < runs[i].n; ++ j) {
+				iovs[k + j].iov_base = (void*) runs[i].bufs[j];
+				iovs[k + j].iov_len = PAGE_SIZE;
+			}
+			reqs[i].fd = fd[runs[i].fileID];
+			reqs[i].write = write;
+			reqs[i].iov = &iovs[k];
+			reqs[i].iovcnt = runs[i].n;
+			reqs[i].offset = (off_t)runs[i].pageID << PAGE_SIZE_IDX;
+			// 使用O_DIRECT时没有对齐的段不提交，之后由_rw同步读写
+			if (skip[i] || each || (direct[runs[i].fileID] && !_aligned(&iovs[k], runs[i].n))) {
+				reqs[i].iovcnt = 0;
+			}
+		}
+		if (aio != nullptr) {
+			aio->run(reqs.data(), count, res.data());
+		}
+		int failed = 0;
+		for (int i = 0, k = 0; i < count; k += runs[i].n, ++ i) {
+			runs[i].result = 0;
+			if (skip[i]) {
+				printf("In FileManager::writeRuns, cannot write the checksums of %d pages from page %d of file %d: %s\n",
+					runs[i].n, runs[i].pageID, runs[i].fileID, strerror(errno));
+				runs[i].result = -1;
+				++ failed;
+				continue;
+			}
+			if (write && compressed[runs[i].fileID]) {
+				for (int j = 0; j < runs[i].n && runs[i].result == 0; ++ j) {
+					if (_writeCompressed(runs[i].fileID, runs[i].pageID + j, runs[i].bufs[j]) != 0) {
+						printf("In FileManager::writeRuns, cannot write page %d of file %d: %s\n", runs[i].pageID + j, runs[i].fileID, strerror(errno));
+						runs[i].result = -1;
+						++ failed;
+					}
+				}
+				continue;
+			}
+			size_t expect = (size_t)runs[i].n << PAGE_SIZE_IDX;
+			if (aio == nullptr || res[i] != (ssize_t)expect) {
+				// 没有aio、只完成了一部分或者出错，同步补齐剩下的部分，出错的请求重新做一次
+				size_t done = res[i] > 0 ? res[i] : 0;
+				if (_rw(runs[i].fileID, &iovs[k], runs[i].n, reqs[i].offset, write, done) != 0) {
+					printf("In FileManager::%s, cannot %s %d pages from page %d of file %d: %s\n", write ? "writeRuns" : "readRuns",
+						write ? "write" : "read", runs[i].n, runs[i].pageID, runs[i].fileID, strerror(errno));
+					runs[i].result = -1;
+					++ failed;
+					continue;
+				}
+			}
+			if (!write) {
+				for (int j = 0; j < runs[i].n; ++ j) {
+					if (!_loaded(runs[i].fileID, runs[i].pageID + j, runs[i].bufs[j])) {
+						runs[i].result = FILE_PAGE_CORRUPT;
+					}
+				}
+				if (runs[i].result != 0) {
+					++ failed;
+				}
+			}
+		}
+		return failed;
+	}
+	static FileManager *instance;
+	FileManager() {
+		MyBitMap::initConst();
+		fm = new MyBitMap(MAX_FILE_NUM, 1);
+		tm = new MyBitMap(MAX_TYPE_NUM, 1);
+		for (int i = 0; i < MAX_FILE_NUM; ++ i) {
+			mapped[i] = NULL;
+			mappedPages[i] = 0;
+			compressed[i] = false;
+			direct[i] = false;
+			written[i] = false;
+			blockSize[i] = PAGE_SIZE;
+			allocEnd[i] = 0;
+		}
+		punchHole = true;
+		extentMax = FILE_EXTENT_MAX;
+		const char* extent = getenv("DBMS_EXTENT_MB");
+		if (extent != NULL) {
+			extentMax = (ll)std::max(atoi(extent), 0) << 20;
+		}
+		zeroPage = (uchar*)mmap(NULL, PAGE_SIZE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		corrupt = 0;
+		directIO = FILE_DIRECT_IO;
+		const char* direct = getenv("DBMS_DIRECT_IO");
+		if (direct != NULL) {
+			directIO = atoi(direct) != 0;
+		}
+	}
+public:
+	/*
+	 * FilManager构造函数
+	 */
+	/*
+	 * @函数名writePage
+	 * @参数fileID:文件id，用于区别已经打开的文件
+	 * @参数pageID:文件的页号
+	 * @参数buf:存储信息的缓存(4字节无符号整数数组)
+	 * @参数off:偏移量
+	 * 功能:将buf+off开始的2048个四字节整数(8kb信息)写入fileID和pageID指定的文件页中
+	 * 返回:成功操作返回0，出错返回-1
+	 */
+	int writePage(int fileID, int pageID, BufType buf, int off) {
+		return writePages(fileID, pageID, &buf, 1, off);
+	}
+	/*
+	 * @函数名writePages
+	 * @参数fileID:文件id，用于区别已经打开的文件
+	 * @参数pageID:第一个页面的页号
+	 * @参数bufs:n个页面的缓存，bufs[i]写入第pageID+i页
+	 * @参数n:页面个数，不超过IOV_MAX
+	 * @参数off:每个缓存中的偏移量
+	 * 功能:用pwritev把n个缓存写入fileID中从pageID开始的连续n个文件页，只写了一部分时继续写剩下的
+	 *           pwritev不改变文件偏移量，不同的线程可以同时读写同一个文件
+	 *           写之前先记录这些页面的校验和，压缩的文件逐页压缩后再写
+	 * 返回:成功操作返回0，出错返回-1
+	 */
+	int writePages(int fileID, int pageID, const BufType* bufs, int n, int off = 0) {
+		written[fileID] = true;
+		if (compressed[fileID]) {
+			for (int i = 0; i < n; ++ i) {
+				if (_writeCompressed(fileID, pageID + i, bufs[i] + off) != 0) {
+					printf("In FileManager::writePages, cannot write page %d of file %d: %s\n", pageID + i, fileID, strerror(errno));
+					return -1;
+				}
+			}
+			return 0;
+		}
+		if (sums[fileID].record(pageID, bufs, n, off) != 0) {
+			printf("In FileManager::writePages, cannot write the checksums of %d pages from page %d of file %d: %s\n", n, pageID, fileID, strerror(errno));
+			return -1;
+		}
+		_reserve(fileID, (off_t)(pageID + n) << PAGE_SIZE_IDX);
+		off_t offset = pageID;
+		offset = (offset << PAGE_SIZE_IDX);
+		struct iovec iov[n];
+		for (int i = 0; i < n; ++ i) {
+			iov[i].iov_base = (void*) (bufs[i] + off);
+			iov[i].iov_len = PAGE_SIZE;
+		}
+		if (_rw(fileID, iov, n, offset, true) != 0) {
+			printf("In FileManager::writePages, cannot write %d pages from page %d of file %d: %s\n", n, pageID, fileID, strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+	/*
+	 * @函数名readRuns
+	 * @参数runs:要读的count段页面
+	 * @参数aio:用于批量提交的AsyncIO，为nullptr时逐段同步读
+	 * 功能:把count段页面读入各自的缓存，aio使用io_uring时这些读请求同时进行
+	 *           只读到一部分或者被打断的请求由同步读补齐，文件末尾之后的页面读出来全是0
+	 *           读出后解压被压缩的页面并检查校验和，有页面损坏的段的result为FILE_PAGE_CORRUPT
+	 * 返回:失败的段数
+	 */
+	int readRuns(PageRun* runs, int count, AsyncIO* aio) {
+		return _ioRuns(runs, count, aio, false);
+	}
+	/*
+	 * @函数名writeRuns
+	 * @参数runs:要写的count段页面
+	 * @参数aio:用于批量提交的AsyncIO，为nullptr时逐段同步写
+	 * 功能:把count段页面写入文件，aio使用io_uring时这些写请求同时进行，写了一部分的请求由同步写补齐
+	 * 返回:失败的段数
+	 */
+	int writeRuns(PageRun* runs, int count, AsyncIO* aio) {
+		return _ioRuns(runs, count, aio, true);
+	}
+	/*
+	 * @函数名readPage
+	 * @参数fileID:文件id，用于区别已经打开的文件
+	 * @参数pageID:文件页号
+	 * @参数buf:存储信息的缓存(4字节无符号整数数组)
+	 * @参数off:偏移量
+	 * 功能:将fileID和pageID指定的文件页中2048个四字节整数(8kb)读入到buf+off开始的内存中
+	 *           文件末尾之后的页面读出来全是0，被压缩的页面读出后解压
+	 * 返回:成功操作返回0，出错返回-1，读出的页面不能解压或者和校验和不同时返回FILE_PAGE_CORRUPT
+	 */
+	int readPage(int fileID, int pageID, BufType buf, int off) {
+		//int f = fd[fID[type]];
+		off_t offset = pageID;
+		offset = (offset << PAGE_SIZE_IDX);
+		struct iovec iov;
+		iov.iov_base = (void*) (buf + off);
+		iov.iov_len = PAGE_SIZE;
+		if (_rw(fileID, &iov, 1, offset, false) != 0) {
+			printf("In FileManager::readPage, cannot read page %d of file %d: %s\n", pageID, fileID, strerror(errno));
+			return -1;
+		}
+		if (!_loaded(fileID, pageID, buf + off)) {
+			return FILE_PAGE_CORRUPT;
+		}
+		return 0;
+	}
+	/*
+	 * @函数名closeFile
+	 * @参数fileID:用于区别已经打开的文件
+	 * 功能:关闭文件，上次同步之后写过的文件先落盘
+	 * 返回:操作成功，返回0，出错返回-1
+	 */
+	int closeFile(int fileID) {
+		fm->setBit(fileID, 1);
+		int f = fd[fileID];
+		std::lock_guard<std::mutex> sync(syncLatch);
+		// 关闭之后syncFiles不能再同步它，写过的文件在这里落盘
+		int ret = 0;
+		if (written[fileID].exchange(false) && (fdatasync(f) != 0 || sums[fileID].sync() != 0)) {
+			printf("In FileManager::closeFile, cannot sync file %d: %s\n", fileID, strerror(errno));
+			ret = -1;
+		}
+		if (mapped[fileID] != NULL) {
+			munmap(mapped[fileID], (size_t)mappedPages[fileID] << PAGE_SIZE_IDX);
+			mapped[fileID] = NULL;
+			mappedPages[fileID] = 0;
+		}
+		sums[fileID].close();
+		compressed[fileID] = false;
+		direct[fileID] = false;
+		{
+			std::lock_guard<std::mutex> guard(inflateLatch);
+			for (auto& page : inflated[fileID]) {
+				free(page.second);
+			}
+			inflated[fileID].clear();
+		}
+		// 即使close出错，文件描述符也已经被释放，不能重试
+		if (close(f) != 0) {
+			printf("In FileManager::closeFile, error when closing file %d: %s\n", fileID, strerror(errno));
+			return -1;
+		}
+		return ret;
+	}
+	/*
+	 * @函数名syncFiles
+	 * 功能:把上次同步之后写过的文件和它们的校验和文件落盘(fdatasync)，其他文件和文件系统上的其他数据不受影响
+	 *           关闭的文件已经在closeFile时落盘
+	 * 返回:成功返回0，有文件同步失败时返回-1，这个文件仍被记为写过
+	 */
+	int syncFiles() {
+		std::lock_guard<std::mutex> sync(syncLatch);
+		int ret = 0;
+		for (int i = 0; i < MAX_FILE_NUM; ++ i) {
+			if (written[i].exchange(false) && (fdatasync(fd[i]) != 0 || sums[i].sync() != 0)) {
+				printf("In FileManager::syncFiles, cannot sync file %d: %s\n", i, strerror(errno));
+				written[i] = true;
+				ret = -1;
+			}
+		}
+		return ret;
+	}
+	/*
+	 * @函数名createFile
+	 * @参数name:文件名
+	 * 功能:新建name指定的文件名
+	 * 返回:操作成功，返回true
+	 */
+	bool createFile(const char* name) {
+		return _createFile(name) == 0;
+		// return true;
+	}
+	/*
+	 * @函数名openFile
+	 * @参数name:文件名
+	 * @参数fileID:函数返回时，如果成功打开文件，那么为该文件分配一个id，记录在fileID中
+	 * @参数readOnly:是否只读打开，只读打开的文件被映射到内存中，页面通过mappedPage直接访问，不能写
+	 * 功能:打开文件,如果文件不存在也不会创建，而是返回false
+	 * 返回:如果成功打开，在fileID中存储为该文件分配的id，返回true，否则返回false
+	 */
+	bool openFile(const char* name, int& fileID, bool readOnly = false) {
+		fileID = fm->findLeftOne();
+		fm->setBit(fileID, 0);
+		if (_openFile(name, fileID, readOnly) != 0) {
+			// 打开失败时归还fileID
+			fm->setBit(fileID, 1);
+			return false;
+		}
+		return true;
+	}
+	/*
+	 * @函数名pageCount
+	 * @参数fileID:文件id
+	 * 功能:返回fileID指定的文件在磁盘上的页数，页号不小于它的页面还没有被写过
+	 */
+	int pageCount(int fileID) {
+		struct stat st;
+		if (fstat(fd[fileID], &st) != 0) {
+			return 0;
+		}
+		return (int)(st.st_size >> PAGE_SIZE_IDX);
+	}
+	/*
+	 * @函数名mappedPage
+	 * @参数fileID:文件id
+	 * @参数pageID:文件页号
+	 * 返回:文件被映射时，返回(fileID,pageID)在映射中的地址，打开时文件末尾之后的页面返回一个全0的页面
+	 *           文件没有被映射时返回NULL，页面需要通过缓存读
+	 *           被压缩的页面返回解压后的副本，不能解压时也返回NULL
+	 *           返回的内存是只读的，在closeFile之前一直有效
+	 */
+	BufType mappedPage(int fileID, int pageID) {
+		if (mapped[fileID] == NULL) {
+			return NULL;
+		}
+		if (pageID >= mappedPages[fileID]) {
+			return (BufType)zeroPage;
+		}
+		uchar* p = mapped[fileID] + ((size_t)pageID << PAGE_SIZE_IDX);
+		// 开头不是magic的页面一定没有压缩，不用查校验和文件
+		if (PageCompression::mayBeCompressed(p)) {
+			return _inflateMapped(fileID, pageID, p);
+		}
+		return (BufType)p;
+	}
+	/*
+	 * @函数名isMapped
+	 * 返回:fileID是否被映射到内存中
+	 */
+	bool isMapped(int fileID) {
+		return mapped[fileID] != NULL;
+	}
+	/*
+	 * @函数名adviseWillNeed
+	 * 功能:提示内核从pageID开始的n个页面马上会被访问，内核在后台读入它们，只对被映射的文件有效
+	 */
+	void adviseWillNeed(int fileID, int pageID, int n) {
+		if (mapped[fileID] == NULL || pageID >= mappedPages[fileID]) {
+			return;
+		}
+		if (n > mappedPages[fileID] - pageID) {
+			n = mappedPages[fileID] - pageID;
+		}
+		madvise(mapped[fileID] + ((size_t)pageID << PAGE_SIZE_IDX), (size_t)n << PAGE_SIZE_IDX, MADV_WILLNEED);
+	}
+	/*
+	 * @函数名usingDirectIO
+	 * 返回:以读写方式打开的文件是否使用O_DIRECT
+	 */
+	bool usingDirectIO() {
+		return directIO;
+	}
+	/*
+	 * @函数名setCompression
+	 * @参数fileID:以读写方式打开的文件
+	 * @参数on:之后写入的页面是否压缩
+	 * 功能:已经在文件中的页面在下一次写入之前保持原样，每个页面是否被压缩记录在校验和文件中
+	 *           文件关闭后恢复为不压缩，每次打开时重新设置
+	 */
+	void setCompression(int fileID, bool on) {
+		compressed[fileID] = on;
+	}
+	bool isCompressed(int fileID) {
+		return compressed[fileID];
+	}
+	/*
+	 * @函数名diskUsage
+	 * @参数name:文件名
+	 * @参数logical:文件的大小(字节)
+	 * @参数physical:文件实际占用的磁盘空间(字节)，打洞释放的部分不计入
+	 * 返回:文件存在时返回true
+	 */
+	static bool diskUsage(const char* name, ull& logical, ull& physical) {
+		struct stat st;
+		if (stat(name, &st) != 0) {
+			return false;
+		}
+		logical = st.st_size;
+		physical = (ull)st.st_blocks * 512;
+		return true;
+	}
+	/*
+	 * @函数名corruptPages
+	 * 返回:启动以来读出时校验和不对的页面数
+	 */
+	ull corruptPages() {
+		return corrupt;
+	}
+	int newType() {
+		int t = tm->findLeftOne();
+		tm->setBit(t, 0);
+		return t;
+	}
+	void closeType(int typeID) {
+		tm->setBit(typeID, 1);
+	}
+	void shutdown() {
+		delete tm;
+		delete fm;
+	}
+	~FileManager() {
+		this->shutdown();
+	}
+	static FileManager* Instance(){
+		if(instance == nullptr)
+			instance = new FileManager();
+		return instance;
+	}
+};
+#endif
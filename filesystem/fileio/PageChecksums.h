@@ -0,0 +1,221 @@
+#ifndef PAGE_CHECKSUMS_H
+#define PAGE_CHECKSUMS_H
+#include <string>
+#include <vector>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "../utils/pagedef.h"
+#include "../utils/CRC32C.h"
+/*
+ * PageChecksums
+ * 一个数据文件中页面的CRC32C，存放在同一目录下的<文件名>PAGE_CRC_SUFFIX中，第i页对应一项{cur, prev}
+ * 页面本身没有空闲的字节(记录页、位图页和B+树节点都用满了8KB)，所以校验和放在单独的文件里
+ * 写页面之前先写它的校验和，cur为新内容的校验和，prev为上一次写入的内容的校验和
+ *   进程在两次写之间崩溃时，页面仍然是旧内容，和prev相同，不会被误认为损坏
+ *   校验和文件在写页面之前不同步，两者只在closeFile和FileManager::syncFiles之后一致
+ *   系统崩溃时它们可能以任意顺序落盘，之后没有被恢复重写的页面可能被报告为损坏，校验和不能用来发现页面写了一半
+ * 为0的项表示没有记录(页面还没有写过，或者文件是在有校验和之前写的)，读这样的页面时不检查
+ *   prev为0时页面还可能是第一次写之前的全0页面
+ * 校验和是页面(没有压缩的内容)的CRC32C的低31位，计算出来是0的记为1
+ * 最高位PACKED表示这个内容在文件中是压缩后写入的，读的时候只有记录为压缩的页面才解压，见PageCompression::load
+ * 所有成员函数都可以由多个线程同时调用
+ */
+class PageChecksums {
+	struct Entry {
+		uint cur;
+		uint prev;
+	};
+	int fd;
+	std::vector<Entry> entries;
+	std::mutex latch;
+	static uint _sum(const void* page) {
+		uint c = crc32c(page, PAGE_SIZE) & ~PACKED;
+		return c == 0 ? 1 : c;
+	}
+public:
+	static const uint PACKED = 0x80000000u;
+	// kinds的返回值中的位
+	static const int RAW_KIND = 1, PACKED_KIND = 2;
+	PageChecksums():fd(-1) {}
+	PageChecksums(const PageChecksums&) = delete;
+	PageChecksums& operator=(const PageChecksums&) = delete;
+	~PageChecksums() {
+		close();
+	}
+	/*
+	 * @函数名pathOf
+	 * 返回:数据文件name的校验和文件名
+	 */
+	static std::string pathOf(const char* name) {
+		return std::string(name) + PAGE_CRC_SUFFIX;
+	}
+	/*
+	 * @函数名remove
+	 * 功能:删除数据文件name和它的校验和文件
+	 * 返回:同remove(name)
+	 */
+	static int remove(const char* name) {
+		unlink(pathOf(name).data());
+		return ::remove(name);
+	}
+	/*
+	 * @函数名rename
+	 * 功能:把数据文件from和它的校验和文件改名为to
+	 * 返回:同rename(from, to)
+	 */
+	static int rename(const char* from, const char* to) {
+		std::string sumTo = pathOf(to);
+		if (::rename(pathOf(from).data(), sumTo.data()) != 0) {
+			unlink(sumTo.data());
+		}
+		return ::rename(from, to);
+	}
+	/*
+	 * @函数名open
+	 * @参数name:数据文件名
+	 * @参数readOnly:为true时只读，校验和文件不存在时不创建，这时读页面都不检查
+	 * 功能:打开name的校验和文件并读入所有的项
+	 * 返回:成功返回true，校验和文件不能创建或读出错时返回false，这时不记录也不检查
+	 */
+	bool open(const char* name, bool readOnly) {
+		close();
+		std::string path = pathOf(name);
+		int f = ::open(path.data(), readOnly ? O_RDONLY : O_RDWR | O_CREAT, 0666);
+		if (f == -1) {
+			return readOnly && errno == ENOENT;
+		}
+		struct stat st;
+		if (fstat(f, &st) != 0) {
+			::close(f);
+			return false;
+		}
+		std::vector<Entry> loaded(st.st_size / sizeof(Entry));
+		size_t want = loaded.size() * sizeof(Entry), got = 0;
+		while (got < want) {
+			ssize_t ret = pread(f, (char*)loaded.data() + got, want - got, got);
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret <= 0) {
+				::close(f);
+				return false;
+			}
+			got += ret;
+		}
+		std::lock_guard<std::mutex> guard(latch);
+		fd = f;
+		entries.swap(loaded);
+		return true;
+	}
+	void close() {
+		std::lock_guard<std::mutex> guard(latch);
+		if (fd != -1) {
+			::close(fd);
+			fd = -1;
+		}
+		entries.clear();
+	}
+	/*
+	 * @函数名record
+	 * @参数pageID:第一个页面的页号
+	 * @参数bufs:n个页面的内容，bufs[i]是第pageID+i页，每个缓存从偏移off(四字节整数)处开始
+	 * @参数packed:这些页面是否压缩后写入
+	 * 功能:在这n个页面写入文件之前，记录并写入它们的校验和
+	 * 返回:成功返回0，校验和文件写失败返回-1，这时页面不能写，否则之后读出来会被认为损坏
+	 */
+	int record(int pageID, const BufType* bufs, int n, int off = 0, bool packed = false) {
+		uint sums[n];
+		for (int i = 0; i < n; ++ i) {
+			sums[i] = _sum(bufs[i] + off) | (packed ? PACKED : 0);
+		}
+		std::lock_guard<std::mutex> guard(latch);
+		if (fd == -1) {
+			return 0;
+		}
+		if (entries.size() < (size_t)(pageID + n)) {
+			entries.resize(pageID + n, Entry{0, 0});
+		}
+		bool changed = false;
+		for (int i = 0; i < n; ++ i) {
+			Entry& e = entries[pageID + i];
+			if (e.cur != sums[i]) {
+				e.prev = e.cur;
+				e.cur = sums[i];
+				changed = true;
+			}
+		}
+		if (!changed) {
+			return 0;
+		}
+		const char* p = (const char*)&entries[pageID];
+		size_t want = n * sizeof(Entry), done = 0;
+		off_t offset = (off_t)pageID * sizeof(Entry);
+		while (done < want) {
+			ssize_t ret = pwrite(fd, p + done, want - done, offset + done);
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret <= 0) {
+				return -1;
+			}
+			done += ret;
+		}
+		return 0;
+	}
+	/*
+	 * @函数名kinds
+	 * @参数pageID:页号
+	 * 返回:记录的两个版本的写入方式，RAW_KIND和PACKED_KIND的组合，没有记录时返回0
+	 */
+	int kinds(int pageID) {
+		std::lock_guard<std::mutex> guard(latch);
+		if ((size_t)pageID >= entries.size()) {
+			return 0;
+		}
+		int ans = 0;
+		for (uint sum : {entries[pageID].cur, entries[pageID].prev}) {
+			if (sum != 0) {
+				ans |= (sum & PACKED) != 0 ? PACKED_KIND : RAW_KIND;
+			}
+		}
+		return ans;
+	}
+	/*
+	 * @函数名verify
+	 * @参数pageID:页号
+	 * @参数page:刚从文件读出(压缩时已经解压)的页面内容
+	 * 返回:页面和记录的校验和之一相同，或者没有记录时返回true，否则页面已经损坏，返回false
+	 */
+	bool verify(int pageID, const void* page) {
+		Entry e;
+		{
+			std::lock_guard<std::mutex> guard(latch);
+			if ((size_t)pageID >= entries.size()) {
+				return true;
+			}
+			e = entries[pageID];
+		}
+		if (e.cur == 0 && e.prev == 0) {
+			return true;
+		}
+		uint sum = _sum(page);
+		if (sum == (e.cur & ~PACKED) || sum == (e.prev & ~PACKED)) {
+			return true;
+		}
+		// 第一次写页面时在写校验和之后崩溃，页面还在文件末尾之后，读出来全是0
+		static const uint zeroSum = _sum(std::vector<uchar>(PAGE_SIZE, 0).data());
+		return e.prev == 0 && sum == zeroSum;
+	}
+	/*
+	 * @函数名sync
+	 * 功能:把校验和文件同步到磁盘
+	 */
+	int sync() {
+		std::lock_guard<std::mutex> guard(latch);
+		return fd == -1 ? 0 : fdatasync(fd);
+	}
+};
+#endif
@@ -0,0 +1,102 @@
+#ifndef PAGE_COMPRESSION_H
+#define PAGE_COMPRESSION_H
+#include <string.h>
+#include "../utils/pagedef.h"
+#include "../utils/CRC32C.h"
+#include "../utils/LZ4.h"
+#include "PageChecksums.h"
+/*
+ * PageCompression
+ * 压缩的页面在文件中的格式，见FileManager::setCompression
+ * 压缩的页面仍然放在第pageID页的位置，开头是一个Frame，后面是LZ4压缩的数据，再后面的部分被打洞释放，读出来全是0
+ * 页面是否被压缩记录在校验和文件中(PageChecksums::PACKED)，不能只看页面开头
+ *   没有压缩的记录页开头是第一条记录，用户可以插入一条恰好像Frame的记录
+ * 同一个文件中可以同时有压缩和没有压缩的页面
+ */
+class PageCompression {
+	struct Frame {
+		uint magic;
+		ushort length;
+		ushort reserved;
+		uint crc;
+	};
+	static const uint MAGIC = 0x345A4C50;
+public:
+	static const int FRAME_SIZE = sizeof(Frame);
+	/*
+	 * @函数名compress
+	 * @参数page:PAGE_SIZE字节的页面
+	 * @参数stored:输出缓存，大小为PAGE_SIZE
+	 * @参数limit:压缩后最多占用的字节数(包括Frame)，不超过PAGE_SIZE
+	 * 返回:压缩后在文件中的字节数(包括Frame)，超过limit个字节时返回0，这时页面按原样写
+	 */
+	static int compress(const void* page, uchar* stored, int limit) {
+		if (limit <= FRAME_SIZE) {
+			return 0;
+		}
+		int len = LZ4::compress((const uchar*)page, PAGE_SIZE, stored + FRAME_SIZE, limit - FRAME_SIZE);
+		if (len == 0) {
+			return 0;
+		}
+		Frame f;
+		f.magic = MAGIC;
+		f.length = len;
+		f.reserved = 0;
+		f.crc = crc32c(stored + FRAME_SIZE, len);
+		memcpy(stored, &f, FRAME_SIZE);
+		return FRAME_SIZE + len;
+	}
+	/*
+	 * @函数名mayBeCompressed
+	 * 返回:stored开头是否是magic，不是时一定没有压缩，用来快速跳过没有压缩的页面
+	 */
+	static bool mayBeCompressed(const void* stored) {
+		uint magic;
+		memcpy(&magic, stored, sizeof(uint));
+		return magic == MAGIC;
+	}
+	/*
+	 * @函数名load
+	 * @参数sums:页面所在文件的校验和
+	 * @参数pageID:页号
+	 * @参数stored:从文件读出的PAGE_SIZE字节
+	 * @参数page:还原后的页面，可以和stored相同
+	 * @参数packedFile:文件是否压缩，只在sums中没有这一页的记录时使用
+	 * 功能:只解压写入时被压缩的页面
+	 *           记录的两个版本一个压缩一个没有压缩时(切换压缩后在写校验和与写页面之间崩溃)，原样和校验和相同的是没有压缩的
+	 * 返回:同inflate，没有压缩时page的内容不变
+	 */
+	static int load(PageChecksums& sums, int pageID, const void* stored, void* page, bool packedFile) {
+		int kinds = sums.kinds(pageID);
+		bool packed = kinds == 0 ? packedFile : (kinds & PageChecksums::PACKED_KIND) != 0;
+		if (!packed || ((kinds & PageChecksums::RAW_KIND) != 0 && sums.verify(pageID, stored))) {
+			return 0;
+		}
+		return inflate(stored, page);
+	}
+	/*
+	 * @函数名inflate
+	 * @参数stored:从文件读出的PAGE_SIZE字节
+	 * @参数page:解压后的页面，可以和stored相同
+	 * 返回:stored被压缩时解压到page，返回1；没有压缩时返回0，这时page的内容不变(和stored不同时不复制)
+	 *           Frame完整但数据解压失败时返回-1，页面已经损坏
+	 */
+	static int inflate(const void* stored, void* page) {
+		if (!mayBeCompressed(stored)) {
+			return 0;
+		}
+		Frame f;
+		memcpy(&f, stored, FRAME_SIZE);
+		const uchar* data = (const uchar*)stored + FRAME_SIZE;
+		if (f.reserved != 0 || f.length == 0 || f.length > PAGE_SIZE - FRAME_SIZE || crc32c(data, f.length) != f.crc) {
+			return 0;
+		}
+		uchar out[PAGE_SIZE];
+		if (LZ4::decompress(data, f.length, out, PAGE_SIZE) != PAGE_SIZE) {
+			return -1;
+		}
+		memcpy(page, out, PAGE_SIZE);
+		return 1;
+	}
+};
+#endif
@@ -73,6 +73,9 @@ class Global{
 		static void NoSuchDb(int pos, const char* name){
 			newError(pos, format("No database named %s", name));
 		}
+		static void ReadOnlyDb(int pos){
+			newError(pos, "Database is opened read-only");
+		}
 
 		// table level
 		static void TableNameTooLong(int pos){
@@ -96,6 +99,21 @@ class Global{
 		static void TableNameReserved(int pos, const char* name){
 			newError(pos, format("Table name %s is reserved for DBMS", name));
 		}
+		static void UnknownCompression(int pos, const char* name){
+			newError(pos, format("Unknown compression %s, use \"lz4\" or \"none\"", name));
+		}
+		static void UnknownRowFormat(int pos, const char* name){
+			newError(pos, format("Unknown row format %s, use \"fixed\" or \"slotted\"", name));
+		}
+		static void RecordTooLong(int pos){
+			newError(pos, format("A record should fit in a page of %d bytes", PAGE_SIZE));
+		}
+		static void TableFull(int pos, const char* name){
+			newError(pos, format("Table %s is full", name));
+		}
+		static void UpdateFailed(int pos, const char* name){
+			newError(pos, format("Failed to update a record in table %s", name));
+		}
 
 		// field level
 		static void NoSuchField(int pos, const char* name){
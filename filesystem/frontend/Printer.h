@@ -41,7 +41,7 @@ class Printer{
         printf("%d Lines selected\n", RowCount - 1);
     }
 
-    static std::string FieldToStr(const Record& tmpRec, uchar type, uchar index, ushort length, uint offset);
+    static std::string FieldToStr(const uchar* data, uchar type, uchar index, ushort length, uint offset);
 };
 
 #endif
\ No newline at end of file
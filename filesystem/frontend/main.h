@@ -5,6 +5,7 @@
 #include <string>
 #include <set>
 #include <stdio.h>
+#include <strings.h>
 #include <vector>
 #include <algorithm>
 #include "../utils/pagedef.h" // 全局宏定义
@@ -452,6 +453,55 @@ struct ParsingHelper{
 		return identical(name, DB_RESERVED_TABLE_NAME, MAX_TABLE_NAME_LEN) || identical(name, IDX_RESERVED_TABLE_NAME, MAX_TABLE_NAME_LEN)
 			|| identical(name, VARCHAR_RESERVED_TABLE_NAME, MAX_TABLE_NAME_LEN);
 	}
+
+	/**
+	 * 解析COMPRESSION = "..."选项, 不区分大小写
+	 * 返回1表示用lz4压缩, 0表示不压缩("none"、空串或者没有这个选项), -1表示不认识的压缩算法
+	*/
+	static int CompressionOption(const std::string& value){
+		if(value.empty() || strcasecmp(value.data(), "none") == 0)
+			return 0;
+		if(strcasecmp(value.data(), "lz4") == 0)
+			return 1;
+		return -1;
+	}
+
+	/**
+	 * 解析ROW_FORMAT = "..."选项, 不区分大小写
+	 * 返回1表示变长记录的slotted page(见SlottedPage), 0表示定长记录("fixed"或者空串), -1表示不认识的格式
+	*/
+	static int RowFormatOption(const std::string& value){
+		if(value.empty() || strcasecmp(value.data(), "fixed") == 0)
+			return 0;
+		if(strcasecmp(value.data(), "slotted") == 0)
+			return 1;
+		return -1;
+	}
+
+	/**
+	 * 把建表时的选项(tbOption)转成Header::options中的位, 同一个选项出现多次时以最后一次为准
+	*/
+	static bool TableOptions(const Type& opts, uint& options){
+		for(auto it = opts.setList.begin(); it != opts.setList.end(); it++){
+			if(it->colName == "compression"){
+				int compression = CompressionOption(it->value.str);
+				if(compression < 0){
+					Global::UnknownCompression(opts.pos, it->value.str.data());
+					return false;
+				}
+				options = compression ? (options | Header::Compressed) : (options & ~Header::Compressed);
+			}
+			else{
+				int slotted = RowFormatOption(it->value.str);
+				if(slotted < 0){
+					Global::UnknownRowFormat(opts.pos, it->value.str.data());
+					return false;
+				}
+				options = slotted ? (options | Header::Slotted) : (options & ~Header::Slotted);
+			}
+		}
+		return true;
+	}
 };
 
 struct Debugger{
@@ -745,7 +795,7 @@ struct Debugger{
 				if(canBuildScanner[i])
 					multiScanner.AddScanner(ParsingHelper::buildScanner(tables[i], helpers[i], whereHelpersCol[i], cmpUnitsNeeded[i]));
 				else
-					multiScanner.AddScanner(tables[i]->GetScanner([](const Record& rec)->bool{return true;}));
+					multiScanner.AddScanner(tables[i]->GetScanner([](const RecordView& rec)->bool{return true;}));
 			}
 			multiScanner.PrintSelection(wantedCols);
 			multiScanner.DeleteScanners();
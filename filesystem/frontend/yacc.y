@@ -36,7 +36,8 @@ extern "C"			//为了能够在C++程序里面调用C函数，必须把每一个
 %token	INDEX		AND			DATE 	FLOAT
 %token	FOREIGN		REFERENCES	NUMERIC	ON
 %token 	TO			EXIT		COPY	WITH
-%token 	DELIMITER	BIGINT
+%token 	DELIMITER	BIGINT		BUFFER	STATUS
+%token	READONLY	COMPRESSION	ROW_FORMAT
 // 以上是SQL关键字
 %token 	INT_LIT		STRING_LIT	FLOAT_LIT	DATE_LIT
 %token 	IDENTIFIER	GE			LE 			NE
@@ -94,15 +95,36 @@ SysStmt		:	SHOW DATABASES
 					printf("YACC: show db\n");
 					Global::action = [](std::vector<Type> &typeVec)->bool{
 						Scanner* scanner = Global::dbms->ShowDatabases();
-						Record rec;
-						while(scanner->NextRecord(&rec)){
+						RecordView rec;
+						while(scanner->NextView(&rec)){
 							printf("%.*s\n", MAX_DB_NAME_LEN, rec.GetData() + 4); // null word
-							rec.FreeMemory();
 						}
 						scanner->Reset();
 						return true;
 					};
 				}
+			|	SHOW TABLE STATUS
+				{
+					printf("YACC: show table status\n");
+					Global::types.push_back($1);
+					Global::action = [](std::vector<Type> &typeVec)->bool{
+						Type &T1 = typeVec[0];
+						if(Global::dbms->CurrentDatabase() == nullptr){
+							Global::NoActiveDb(T1.pos);
+							return false;
+						}
+						Global::dbms->CurrentDatabase()->ShowTableStatus();
+						return true;
+					};
+				}
+			|	SHOW BUFFER STATUS
+				{
+					printf("YACC: show buffer status\n");
+					Global::action = [](std::vector<Type> &typeVec)->bool{
+						Global::dbms->ShowBufferStatus();
+						return true;
+					};
+				}
 			;
 
 DbStmt		:	CREATE DATABASE IDENTIFIER
@@ -159,6 +181,24 @@ DbStmt		:	CREATE DATABASE IDENTIFIER
 						return true;
 					};
 				}
+			|	USE IDENTIFIER READONLY
+				{
+					printf("YACC: use db readonly\n");
+					Global::types.push_back($2);
+					Global::action = [](std::vector<Type> &typeVec)->bool{
+						Type &T2 = typeVec[0];
+						if(T2.val.str.length() > MAX_DB_NAME_LEN){
+							Global::DbNameTooLong(T2.pos);
+							return false;
+						}
+						Database* useRet = Global::dbms->UseDatabase(T2.val.str.data(), true);
+						if(!useRet){
+							Global::NoSuchDb(T2.pos, T2.val.str.data());
+							return false;
+						}
+						return true;
+					};
+				}
 			|	SHOW TABLES
 				{
 					printf("YACC: show tb\n");
@@ -171,10 +211,9 @@ DbStmt		:	CREATE DATABASE IDENTIFIER
 							return false;
 						}
 						Scanner* scanner = curDB->ShowTables();
-						Record rec;
-						while(scanner->NextRecord(&rec)){
+						RecordView rec;
+						while(scanner->NextView(&rec)){
 							printf("%.*s\n", MAX_TABLE_NAME_LEN, rec.GetData() + 4); // null word
-							rec.FreeMemory();
 						}
 						scanner->Reset();
 						return true;
@@ -193,6 +232,10 @@ DbStmt		:	CREATE DATABASE IDENTIFIER
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						Table* table = Global::dbms->CurrentDatabase()->OpenTable(T2.val.str.data());
 						if(table == nullptr){
 							Global::NoSuchTable(T2.pos, T2.val.str.data());
@@ -211,15 +254,36 @@ DbStmt		:	CREATE DATABASE IDENTIFIER
 				}
 			;
 
+// 建表时的选项, 依次放入setList, 见ParsingHelper::TableOptions
+// COMPRESSION = "lz4"/"none", ROW_FORMAT = "fixed"/"slotted"
+tbOption	:	/* empty */
+				{
+					$$.setList.clear();
+				}
+			|	tbOption COMPRESSION '=' STRING_LIT
+				{
+					$$ = $1;
+					$$.pos = $4.pos;
+					$$.setList.push_back(SetInstr("compression", $4.val));
+				}
+			|	tbOption ROW_FORMAT '=' STRING_LIT
+				{
+					$$ = $1;
+					$$.pos = $4.pos;
+					$$.setList.push_back(SetInstr("row_format", $4.val));
+				}
+			;
+
 // header.attrLenth是原始长度
-TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
+TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')' tbOption
 				{
 					printf("YACC: create tb\n");
 					Global::types.push_back($1);
 					Global::types.push_back($3);
 					Global::types.push_back($5);
+					Global::types.push_back($7);
 					Global::action = [](std::vector<Type> &typeVec)->bool{
-						Type &T1 = typeVec[0], &T3 = typeVec[1], &T5 = typeVec[2];
+						Type &T1 = typeVec[0], &T3 = typeVec[1], &T5 = typeVec[2], &T7 = typeVec[3];
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -232,6 +296,10 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(Global::dbms->CurrentDatabase()->TableExists(T3.val.str.data())){
 							Global::TableNameConflict(T3.pos);
 							return false;
@@ -239,6 +307,8 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 						std::set<std::string> allNames;
 						Header header;
 						header.nullMask = 0; // the default value is 0xffffffff
+						if(!ParsingHelper::TableOptions(T7, header.options))
+							return false;
 						int pos = 0;
 						for(auto it = T5.fieldList.begin(); it != T5.fieldList.end(); it++){
 							if(it->name.length() > MAX_ATTRI_NAME_LEN){
@@ -261,7 +331,11 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							pos++;
 						}
 						header.recordLenth += 4;
-						header.slotNum = PAGE_SIZE / header.recordLenth;
+						header.slotNum = Table::SlotNumOf(&header);
+						if(header.slotNum == 0){
+							Global::RecordTooLong(T5.pos);
+							return false;
+						}
 						// handle constraints
 						bool hasPrimary = false;
 						// lambda function, get the index of a given name
@@ -300,7 +374,6 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 									// update header
 									uchar colIndex = getNameIndex(*id_it);
 									clearBitFromLeft(header.nullMask, colIndex); // 字段可以不声明为not null,但仍在建表时声明为主键,这时自动加上not null约束
-									header.primaryKeyMask |= 1 << (31 - colIndex);
 									header.primaryKeyID[primaryCols.size()] = colIndex;
 									primaryCols.push_back(colIndex);
 								}
@@ -434,6 +507,10 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -517,6 +594,10 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -685,7 +766,11 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							}
 						}
 						// now there is no error in input, start insertion
-						int idxRecPos = 0;
+						// 先构造所有记录, 再用InsertRecords一起插入, 最后逐条更新索引
+						int recordLength = header->recordLenth, rowCount = TT.valLists.size();
+						std::vector<uchar> rows((size_t)rowCount * recordLength);
+						std::vector<RID> rids(rowCount);
+						int rowIndex = 0;
 						for(auto list_it = TT.valLists.begin(); list_it != TT.valLists.end(); list_it++){ // for every valList, build a record
 							int arg_pos = 0;
 							memset(tmpRec.GetData(), 0, 4); // set null word to 0
@@ -706,10 +791,19 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 									memcpy(tmpRec.GetData() + table->ColOffset(arg_pos), arg_it->bytes, DataType::lengthOf(header->attrType[arg_pos], header->attrLenth[arg_pos]));
 								arg_pos++;
 							}
-							table->InsertRecord(tmpRec.GetData(), tmpRec.GetRid());
-							// update indexes
+							memcpy(rows.data() + (size_t)rowIndex++ * recordLength, tmpRec.GetData(), recordLength);
+						}
+						int inserted = table->InsertRecords(rows.data(), rowCount, rids.data());
+						// update indexes
+						for(int i = 0; i < inserted; i++){
+							memcpy(tmpRec.GetData(), rows.data() + (size_t)i * recordLength, recordLength);
+							*tmpRec.GetRid() = rids[i];
 							ParsingHelper::InsertIndexes(table, tmpRec);
 						}
+						if(inserted < rowCount){
+							Global::TableFull(T3.pos, T3.val.str.data());
+							return false;
+						}
 						return true;
 					};
 				}
@@ -726,6 +820,10 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -744,6 +842,8 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 						// TODO: use index where possible
 						// build scanner
 						Scanner* scanner = ParsingHelper::buildScanner(table, helpers, whereHelpersCol, cmpUnitsNeeded);
+						// 全表扫描，数据页只经过环形缓冲区
+						BulkAccess bulk(BufPageManager::Instance(), table->FileID());
 						// delete
 						// TODO: update index
 						Record tmpRec;
@@ -773,7 +873,6 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 								}
 							}
 							// 检查slave
-							Record idxRec;
 							bool ok = true;
 							while(scanner->NextRecord(&tmpRec)){
 								for(int i = 0; i < slaves.size(); i++){ // 对于每个slave表
@@ -796,10 +895,10 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 										}
 										// step 2: check existence
 										slaveScanners[i]->SetDemand(slaveBuf, slaves[i]->ColNum(), cmps);
-										// 不用tmpRec是为了防止内存泄露
-										if(slaveScanners[i]->NextRecord(&idxRec)){
+										// 只判断是否存在, 不复制记录
+										RecordView idxRec;
+										if(slaveScanners[i]->NextView(&idxRec)){
 											Global::ModifyReferenced(T1.pos, slaves[i]->GetTableName(), slaves[i]->GetHeader()->constraintName[j]);
-											idxRec.FreeMemory();
 											ok = false;
 											break;
 										}
@@ -851,6 +950,10 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T2.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T2.pos);
 							return false;
@@ -1007,9 +1110,9 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 											idxBufPos += fieldLength;
 										}
 										slaveScanners[i]->SetDemand(slaveBuf, slaves[i]->ColNum(), cmps);
-										if(slaveScanners[i]->NextRecord(&tmpRec)){
+										RecordView slaveRec;
+										if(slaveScanners[i]->NextView(&slaveRec)){
 											Global::ModifyReferenced(T1.pos, slaves[i]->GetTableName(), slaves[i]->GetHeader()->constraintName[*idx_it]);
-											tmpRec.FreeMemory();
 											delete[] idxBuf;
 											ok = false;
 											break;
@@ -1132,7 +1235,11 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 									}
 								}
 							}
-							table->UpdateRecord(*tmpRec.GetRid(), tmpRec.GetData(), 0, 0, table->GetHeader()->recordLenth);
+							if(!table->UpdateRecord(*tmpRec.GetRid(), tmpRec.GetData(), 0, 0, table->GetHeader()->recordLenth)){
+								Global::UpdateFailed(T2.pos, T2.val.str.data());
+								tmpRec.FreeMemory();
+								return false;
+							}
 							// 更新所有索引,包括主键索引
 							ParsingHelper::UpdateIndexes(table, tmpBuf, tmpRec, updateMask);
 							tmpRec.FreeMemory();
@@ -1437,7 +1544,7 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 								if(canBuildScanner[i])
 									multiScanner.AddScanner(ParsingHelper::buildScanner(tables[i], helpers[i], whereHelpersCol[i], cmpUnitsNeeded[i]));
 								else
-									multiScanner.AddScanner(tables[i]->GetScanner([](const Record& rec)->bool{return true;}));
+									multiScanner.AddScanner(tables[i]->GetScanner([](const RecordView& rec)->bool{return true;}));
 							}
 							multiScanner.PrintSelection(wantedCols);
 							multiScanner.DeleteScanners();
@@ -1492,7 +1599,7 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 									wantedCols.push_back(i);
 							}
 							// build scanner
-							Scanner* scanner = table->GetScanner([](const Record& rec)->bool{return true;});
+							Scanner* scanner = table->GetScanner([](const RecordView& rec)->bool{return true;});
 							// Print
 							scanner->PrintSelection(wantedCols);
 							delete scanner;
@@ -1578,7 +1685,7 @@ TbStmt		:	CREATE TABLE IDENTIFIER '(' fieldList ')'
 							}
 							MultiScanner multiScanner;
 							for(int i = 0; i < T4.IDList.size(); i++)
-								multiScanner.AddScanner(tables[i]->GetScanner([](const Record& rec)->bool{return true;}));
+								multiScanner.AddScanner(tables[i]->GetScanner([](const RecordView& rec)->bool{return true;}));
 							multiScanner.PrintSelection(wantedCols);
 							multiScanner.DeleteScanners();
 						}
@@ -1600,6 +1707,10 @@ IdxStmt		:	CREATE INDEX IDENTIFIER ON IDENTIFIER '(' IdList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_INDEX_NAME_LEN){
 							Global::IndexNameTooLong(T3.pos);
 							return false;
@@ -1654,6 +1765,10 @@ IdxStmt		:	CREATE INDEX IDENTIFIER ON IDENTIFIER '(' IdList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_INDEX_NAME_LEN){
 							Global::IndexNameTooLong(T3.pos);
 							return false;
@@ -1695,6 +1810,10 @@ IdxStmt		:	CREATE INDEX IDENTIFIER ON IDENTIFIER '(' IdList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T6.val.str.length() > MAX_INDEX_NAME_LEN){
 							Global::IndexNameTooLong(T6.pos);
 							return false;
@@ -1753,6 +1872,10 @@ IdxStmt		:	CREATE INDEX IDENTIFIER ON IDENTIFIER '(' IdList ')'
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T6.val.str.length() > MAX_INDEX_NAME_LEN){
 							Global::IndexNameTooLong(T6.pos);
 							return false;
@@ -1797,6 +1920,10 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -1838,7 +1965,11 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 						else
 							clearBitFromLeft(header.defaultKeyMask, table->ColNum());
 						header.recordLenth += DataType::lengthOf(T5.field.type, T5.field.length);
-						header.slotNum = PAGE_SIZE / header.recordLenth;
+						header.slotNum = Table::SlotNumOf(&header);
+						if(header.slotNum == 0){
+							Global::RecordTooLong(T5.pos);
+							return false;
+						}
 						header.recordNum = header.exploitedNum = 0;
 						uchar* defaultValue = nullptr;
 						if(header.defaultKeyMask){
@@ -1874,7 +2005,7 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 						}
 						if(table->GetHeader()->primaryIndexPage)
 							indexes.push_back(new BplusTree(Global::dbms->CurrentDatabase()->idx, table->GetHeader()->primaryIndexPage));
-						Scanner* scanner = table->GetScanner([](const Record& rec)->bool{return true;});
+						Scanner* scanner = table->GetScanner([](const RecordView& rec)->bool{return true;});
 						while(scanner->NextRecord(&tmpRec)){
 							memset(recBuf, 0, sizeof(recBuf));
 							memcpy(recBuf, tmpRec.GetData(), table->GetHeader()->recordLenth);
@@ -1921,6 +2052,10 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -1989,7 +2124,7 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 						memmove(header.attrName[dropCol], header.attrName[dropCol + 1], MAX_ATTRI_NAME_LEN * moveNum);
 						memset(header.attrName[table->ColNum() - 1], 0, MAX_ATTRI_NAME_LEN);
 						header.recordLenth -= rmFieldLength;
-						header.slotNum = PAGE_SIZE / header.recordLenth;
+						header.slotNum = Table::SlotNumOf(&header);
 						// 更新索引和外键中列的ID
 						if(header.primaryIndexPage){
 							bool changed = false;
@@ -2037,7 +2172,7 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 						// prepare scanner/rec/rid...
 						RID tmpRID(START_PAGE, 0);
 						Record tmpRec;
-						Scanner* scanner = table->GetScanner([](const Record& rec)->bool{return true;});
+						Scanner* scanner = table->GetScanner([](const RecordView& rec)->bool{return true;});
 						// build default record
 						if(header.defaultKeyMask){
 							table->GetRecord(tmpRID, &tmpRec);
@@ -2097,6 +2232,10 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -2124,6 +2263,36 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 						return true;
 					};
 				}
+			|	ALTER TABLE IDENTIFIER COMPRESSION '=' STRING_LIT
+				{
+					printf("YACC: alter compression\n");
+					Global::types.push_back($1);
+					Global::types.push_back($3);
+					Global::types.push_back($6);
+					Global::action = [](std::vector<Type> &typeVec){
+						Type &T1 = typeVec[0], &T3 = typeVec[1], &T6 = typeVec[2];
+						if(Global::dbms->CurrentDatabase() == nullptr){
+							Global::NoActiveDb(T1.pos);
+							return false;
+						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
+						int compression = ParsingHelper::CompressionOption(T6.val.str);
+						if(compression < 0){
+							Global::UnknownCompression(T6.pos, T6.val.str.data());
+							return false;
+						}
+						Table* table = Global::dbms->CurrentDatabase()->OpenTable(T3.val.str.data());
+						if(table == nullptr){
+							Global::NoSuchTable(T3.pos, T3.val.str.data());
+							return false;
+						}
+						// 已有的页面在语句结束写回表时按新的设置重写
+						return table->SetCompression(compression);
+					};
+				}
 			|	ALTER TABLE IDENTIFIER ADD PRIMARY KEY '(' IdList ')'
 				{
 					// check: any conflict?
@@ -2138,6 +2307,10 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -2193,6 +2366,10 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -2230,6 +2407,10 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -2320,6 +2501,10 @@ AlterStmt	:	ALTER TABLE IDENTIFIER ADD colField
 							Global::NoActiveDb(T1.pos);
 							return false;
 						}
+						if(Global::dbms->CurrentDatabase()->IsReadOnly()){
+							Global::ReadOnlyDb(T1.pos);
+							return false;
+						}
 						if(T3.val.str.length() > MAX_TABLE_NAME_LEN){
 							Global::TableNameTooLong(T3.pos);
 							return false;
@@ -205,7 +205,6 @@ bool BplusTree::_preciseSearch(const uchar* data, BplusTreeNode*& node, int& pos
     }while(MoveNext(node, pos, Comparator::Eq, cmpColNum, data));
 }
 
-// TODO: 如果树高太大,前面的parent可能会被bpm释放  使用checkBuffer()?
 // insertion of duplicate record is permitted
 bool BplusTree::Insert(const uchar* data, const RID& rid){
     header->recordNum++;
@@ -34,6 +34,7 @@ class BplusTree{
         int page;
         int headerIdx;
         uchar* data = nullptr;
+        PageGuard headerGuard; // pins the page of the index header
         static BufPageManager* bpm; // the only usage for bpm is to reuse buffers
         Table* table; // the table that stores all B+ tree nodes, creating & deleting nodes needs to be done through table
         std::vector<BplusTreeNode*> nodes; // stores all opened tree nodes except root, for memory management
@@ -72,13 +73,18 @@ class BplusTree{
         }
 
 
+        void pinHeader(){
+            data = headerGuard.Fetch(bpm, fid, page);
+            headerIdx = headerGuard.Index();
+        }
+
         // load an existing treenode from storage into memory
         BplusTreeNode* GetTreeNode(BplusTreeNode* curNode, uint page){
             BplusTreeNode* node = new BplusTreeNode();
             node->tree = this;
             node->fid = fid;
             node->page = page;
-            node->data = (uchar*)bpm->getPage(fid, page,node->bufIdx);
+            node->checkBuffer();
             node->type = node->data[0] == 0 ? BplusTreeNode::Internal : BplusTreeNode::Leaf; //* type byte: 0 for internal, 1 for leaf
             node->size = *(ushort*)(node->data + 1);
             node->ptrNum = node->type == BplusTreeNode::Internal ? node->size + 1 : node->size;
@@ -101,7 +107,7 @@ class BplusTree{
             delete[] tmp;
             node->page = rid->GetPageNum();
             delete rid;
-            node->data = (uchar*)bpm->getPage(fid, node->page, node->bufIdx);
+            node->checkBuffer();
             node->type = nodeType;
             node->size = 0;
             node->ptrNum = 0;
@@ -146,7 +152,7 @@ class BplusTree{
             page = rid->GetPageNum();
             delete[] tmp;
             delete rid;
-            data = (uchar*)bpm->getPage(fid, page, headerIdx);
+            pinHeader();
             internalMinKey = (header->internalCap - 1) >> 1;
             leafMinKey = (header->leafCap + 1) >> 1;
         }
@@ -155,7 +161,7 @@ class BplusTree{
             this->table = table;
             this->fid = table->FileID();
             page = pageID;
-            data = (uchar*)bpm->getPage(fid, page, headerIdx);
+            pinHeader();
             header = new IndexHeader();
             header->FromString(data);
             CalcColNum();
@@ -166,7 +172,7 @@ class BplusTree{
         }
 
         void UpdateColID(uchar dropCol){
-            data = bpm->reusePage(fid, page, headerIdx, data);
+            pinHeader();
             uchar* colsOffset = data + IndexHeader::IndexColOffset;
             for(int i = 0; i < MAX_COL_NUM; i++){
                 if(colsOffset[i] == COL_ID_NONE)
@@ -179,13 +185,13 @@ class BplusTree{
         }
 
         void UpdateRecordNum(){
-            data = bpm->reusePage(fid, page, headerIdx, data);
+            pinHeader();
             ((uint*)data)[1] = header->recordNum;
             bpm->markDirty(headerIdx);
         }
 
         void UpdateRoot(){
-            data = bpm->reusePage(fid, page, headerIdx, data);
+            pinHeader();
             ((uint*)data)[5] = root->page;
             bpm->markDirty(headerIdx);
         }
@@ -208,8 +214,12 @@ class BplusTree{
                 else{ // get the next leaf node
                     BplusTreeNode* nextNode = GetTreeNode(nullptr, *node->NextLeafPtr());
                     if(DataType::compareArr(nextNode->KeynPtrAt(0), isConstant ? data : node->KeynPtrAt(pos), header->attrType, header->attrLenth, cmpColNum, mode, isConstant, false)){
+                        node->guard.Release(); // a long range scan shouldn't pin every leaf it passes
                         node = nextNode;
                         pos = 0;
+                        // leaves aren't adjacent on disk, so hint the buffer manager along the chain
+                        if(*node->NextLeafPtr() != 0)
+                            bpm->prefetch(fid, *node->NextLeafPtr());
                         return true;
                     }
                     return false;
@@ -233,8 +243,12 @@ class BplusTree{
                 else{ // get the next leaf node
                     BplusTreeNode* nextNode = GetTreeNode(nullptr, *node->NextLeafPtr());
                     if(DataType::compareArrMultiOp(nextNode->KeynPtrAt(0), isConstant ? data : node->KeynPtrAt(pos), header->attrType, header->attrLenth, cmpColNum, cmps, isConstant, false)){
+                        node->guard.Release(); // a long range scan shouldn't pin every leaf it passes
                         node = nextNode;
                         pos = 0;
+                        // leaves aren't adjacent on disk, so hint the buffer manager along the chain
+                        if(*node->NextLeafPtr() != 0)
+                            bpm->prefetch(fid, *node->NextLeafPtr());
                         return true;
                     }
                     return false;
@@ -298,7 +312,9 @@ class BplusTree{
             return true;
         }
 
+        // Modifying methods log their page changes as one group, so a split or merge is redone entirely or not at all
         bool SafeUpdate(const uchar* data, const RID& oldRID, const RID& newRID){
+            LogGroup group(bpm);
             bool res = SearchAndUpdate(data, oldRID, newRID);
             ClearAndWriteBackOpenedNodes();
             return res;
@@ -314,12 +330,14 @@ class BplusTree{
         
         // Memory-safe methods for Insert, Search and Remove
         bool SafeInsert(const uchar* data, const RID& rid){
+            LogGroup group(bpm);
             bool res = Insert(data, rid);
             ClearAndWriteBackOpenedNodes();
             return res;
         }
 
         void SafeRemove(const uchar* data, const RID& rid){
+            LogGroup group(bpm);
             Remove(data, rid);
             ClearAndWriteBackOpenedNodes();
             RemoveNodes();
@@ -2,6 +2,7 @@
 #define BPLUSTREENODE_H
 #include "../utils/pagedef.h"
 #include "../bufmanager/BufPageManager.h"
+#include "../bufmanager/PageGuard.h"
 #include "../RM/RID.h"
 class BplusTree;
 
@@ -29,17 +30,25 @@ class BplusTreeNode{
         uint parentPage = 0; 
         uchar* data; // 8192B of data
         ushort posInParent = -1;  
+        // the node's page stays pinned while the node is opened, unless released by the tree
+        PageGuard guard;
 
         // check if data is still in buffer
+        // only compares page numbers when the page is pinned
         void checkBuffer(){
-            data = bpm->reusePage(fid, page, bufIdx, data);
+            data = guard.Fetch(bpm, fid, page);
+            bufIdx = guard.Index();
         }
 
         // write back dirty node to storage
+        // pages of a logged file are left in bpm, their changes are already in the log
         void writeBack(){
+            guard.Release();
+            if(bpm->isLogged(fid))
+                return;
             int realFid, realPid;
             bpm->getKey(bufIdx, realFid, realPid);
-            if(realFid == fid && realFid == page)
+            if(realFid == fid && realPid == page)
                 bpm->writeBack(bufIdx);
             // otherwise, the page is already cleared from bpm
         }
@@ -0,0 +1,875 @@
+#ifndef LOG_MANAGER_H
+#define LOG_MANAGER_H
+#include "../utils/pagedef.h"
+#include "../utils/CRC32C.h"
+#include "../fileio/PageChecksums.h"
+#include "../fileio/FileManager.h"
+#include "../fileio/PageCompression.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <thread>
+/*
+ * 日志记录的类型
+ * LOG_OPEN: 之后的记录用fileNo表示path指定的文件
+ * LOG_UPDATE: 文件fileNo的第pageID页从offset开始的length个字节被改为记录中的内容
+ * LOG_RENAME: 把文件from改名为to
+ * LOG_REMOVE: 删除文件path
+ * LOG_END: 一组记录结束。一组记录是一次完整的修改，比如插入一条记录(位图页、数据页和表头页)或者B+树的一次插入(包括节点的分裂)
+ *           恢复时只重做完整的组，没有END的组被丢弃
+ * LOG_CHECKPOINT: 检查点，恢复从记录中的redoLSN开始，见Checkpoint
+ */
+enum LogType {
+	LOG_OPEN = 1,
+	LOG_UPDATE,
+	LOG_RENAME,
+	LOG_REMOVE,
+	LOG_END,
+	LOG_CHECKPOINT
+};
+/*
+ * 日志记录的头部，之后是各类型的内容
+ * LOG_OPEN: uint fileNo, 文件路径
+ * LOG_UPDATE: LogUpdateBody, length个字节的新内容
+ * LOG_RENAME: 原路径, '\0', 新路径
+ * LOG_REMOVE: 文件路径
+ * LOG_CHECKPOINT: ull redoLSN, 之后每个文件一项: uint fileNo, ushort路径长度, 路径
+ */
+struct LogRecordHeader {
+	// 整条记录(含头部)的字节数
+	uint length;
+	// type及之后所有内容的CRC32C
+	uint crc;
+	uint type;
+};
+struct LogUpdateBody {
+	uint fileNo;
+	uint pageID;
+	ushort offset;
+	ushort length;
+};
+/*
+ * 日志文件头，占日志文件开头的LOG_HEADER_SIZE字节
+ */
+struct LogFileHeader {
+	uint magic;
+	uint version;
+	// 文件头之后第一个字节的LSN
+	ull baseLSN;
+	// 最近一次完成的检查点记录开始的LSN和它的redoLSN，为0时没有检查点，恢复从baseLSN开始
+	ull checkpointLSN;
+	ull redoLSN;
+};
+/*
+ * LogStats
+ * 日志的统计信息，从日志打开时开始累计
+ */
+struct LogStats {
+	// Commit的次数，和其中不需要自己同步的次数(记录已经由别人的fdatasync带上，或者语句没有修改)
+	ull commits;
+	ull groupedCommits;
+	// fdatasync的次数，包括Commit、页面写回之前的FlushTo和Truncate
+	ull fsyncs;
+	// 写入日志文件的字节数
+	ull writeBytes;
+	// 完成的检查点数
+	ull checkpoints;
+	// 日志打开的秒数，用来计算每秒的提交数和同步数
+	double seconds;
+	LogStats() {
+		memset(this, 0, sizeof(LogStats));
+	}
+	double commitsPerSecond() const {
+		return seconds > 0 ? commits / seconds : 0;
+	}
+	double fsyncsPerSecond() const {
+		return seconds > 0 ? fsyncs / seconds : 0;
+	}
+};
+/*
+ * LogManager
+ * 一个数据库的预写日志(write-ahead log)
+ * 日志记录先追加到LOG_BUFFER_SIZE字节的缓冲区中，缓冲区写满或者FlushTo时顺序写入日志文件
+ * LSN是日志流中的字节位置，一条记录的LSN是它结束的位置，清空日志后LSN继续增长
+ * 缓存管理器写回一个页面之前，调用FlushTo保证修改这个页面的日志记录已经落盘，见BufPageManager::setLog
+ * 日志只记录页面修改后的内容(redo)，恢复时按顺序重做，重做多次的结果相同
+ * 检查点: 缓存管理器写回redoLSN之前修改过的页面后调用Checkpoint，之后恢复从redoLSN开始，之前的日志空间按段释放
+ * 组提交: 同一时刻只有一个线程在fdatasync(syncing为true)，它不持有latch，其他线程可以继续追加记录
+ *           其他要落盘的线程在synced上等待，每次同步完成后检查自己的记录是否已经被带上，多个提交共用一次同步
+ */
+class LogManager {
+private:
+	static const uint MAGIC = 0x4c415744;
+	static const uint VERSION = 2;
+	int fd;
+	// 日志文件所在的目录(数据库目录)，新建、改名和删除文件之后同步它
+	int dirFd;
+	// syncLatch保护syncing，锁的顺序: syncLatch -> latch
+	std::mutex syncLatch;
+	std::condition_variable synced;
+	bool syncing;
+	std::mutex latch;
+	uchar* buf;
+	int used;
+	// buf[0]的LSN，它之前的记录已经写入日志文件
+	ull bufLSN;
+	ull baseLSN;
+	// 恢复开始的位置，之前的日志已经不需要，见Checkpoint
+	ull checkpointLSN;
+	ull redoLSN;
+	// 已经释放空间的日志文件前缀，从LOG_HEADER_SIZE开始
+	off_t punchedTo;
+	// 上次清空日志后有过改名或删除文件，这之后的检查点中的文件表可能和之前的记录对不上，等下一次Truncate
+	bool ddlPending;
+	std::atomic<ull> nextLSN;
+	std::atomic<ull> durableLSN;
+	// 写日志文件失败后不再保证日志完整，FlushTo一直返回false，页面不会被写回
+	bool broken;
+	// 每个fileID对应的fileNo，-1表示这个文件不写日志。只由修改数据库的线程使用
+	int fileNos[MAX_FILE_NUM];
+	std::string paths[MAX_FILE_NUM];
+	uint nextFileNo;
+	// 上次清空日志后打开过的每个路径的fileNo，同一路径再次打开时使用相同的fileNo，检查点记录中保存这张表
+	std::map<std::string, uint> fileNoOf;
+	// 提交延迟(微秒)，见Commit
+	int commitDelay;
+	// 正在Commit中的线程数
+	std::atomic<int> committers;
+	std::atomic<ull> commits;
+	std::atomic<ull> groupedCommits;
+	std::atomic<ull> fsyncs;
+	std::atomic<ull> writeBytes;
+	std::atomic<ull> checkpoints;
+	std::chrono::steady_clock::time_point openTime;
+	/*
+	 * 恢复时一个页面的新内容，covered[i]不为0表示第i个字节被日志记录修改过
+	 * 没有被修改过的字节在写回时从文件中读出
+	 */
+	struct RedoPage {
+		uchar data[PAGE_SIZE];
+		uchar covered[PAGE_SIZE];
+	};
+	typedef std::map<std::pair<std::string, int>, RedoPage*> RedoPages;
+	static bool rwAll(int f, bool write, uchar* p, size_t n, off_t offset) {
+		while (n > 0) {
+			ssize_t ret = write ? pwrite(f, p, n, offset) : pread(f, p, n, offset);
+			if (ret < 0 && errno == EINTR) {
+				continue;
+			}
+			if (ret < 0) {
+				return false;
+			}
+			if (ret == 0) {
+				// 读到文件末尾，之后的部分为0
+				if (write) {
+					return false;
+				}
+				memset(p, 0, n);
+				return true;
+			}
+			p += ret;
+			n -= ret;
+			offset += ret;
+		}
+		return true;
+	}
+	/*
+	 * 把日志之外的修改落盘: 上次同步之后写过的数据文件和它们的校验和文件，以及数据库目录
+	 * 只同步这些文件，文件系统上的其他数据不受影响
+	 */
+	bool syncData() {
+		return FileManager::Instance()->syncFiles() == 0 && fsync(dirFd) == 0;
+	}
+	off_t fileOffset(ull lsn) {
+		return LOG_HEADER_SIZE + (off_t)(lsn - baseLSN);
+	}
+	bool writeHeader() {
+		uchar header[LOG_HEADER_SIZE] = {0};
+		LogFileHeader h;
+		h.magic = MAGIC;
+		h.version = VERSION;
+		h.baseLSN = baseLSN;
+		h.checkpointLSN = checkpointLSN;
+		h.redoLSN = redoLSN;
+		memcpy(header, &h, sizeof(h));
+		return rwAll(fd, true, header, LOG_HEADER_SIZE, 0);
+	}
+	/*
+	 * 把缓冲区中的记录写入日志文件，不等待落盘
+	 */
+	bool writeBufferLocked() {
+		if (used == 0) {
+			return true;
+		}
+		if (!rwAll(fd, true, buf, used, fileOffset(bufLSN))) {
+			printf("In LogManager, cannot write the log: %s\n", strerror(errno));
+			broken = true;
+			return false;
+		}
+		bufLSN += used;
+		writeBytes += used;
+		used = 0;
+		return true;
+	}
+	/*
+	 * 等到lsn之前的记录落盘，或者没有其他线程在同步
+	 * 返回:lsn之前的记录是否已经落盘，为false时调用者成为负责同步的线程，之后要调用endSync
+	 */
+	bool waitSync(std::unique_lock<std::mutex>& lock, ull lsn) {
+		while (lsn > durableLSN.load()) {
+			if (!syncing) {
+				syncing = true;
+				return false;
+			}
+			synced.wait(lock);
+		}
+		return true;
+	}
+	void endSync() {
+		std::lock_guard<std::mutex> lock(syncLatch);
+		syncing = false;
+		synced.notify_all();
+	}
+	/*
+	 * 保证lsn之前的记录已经落盘，调用者负责同步(见waitSync)
+	 * 缓冲区在latch保护下写入日志文件，fdatasync时不持有latch
+	 */
+	bool syncTo(ull lsn) {
+		ull target;
+		{
+			std::lock_guard<std::mutex> lock(latch);
+			if (broken || !writeBufferLocked()) {
+				return false;
+			}
+			target = bufLSN;
+		}
+		if (target > durableLSN.load()) {
+			if (fdatasync(fd) != 0) {
+				printf("In LogManager, cannot sync the log: %s\n", strerror(errno));
+				std::lock_guard<std::mutex> lock(latch);
+				broken = true;
+				return false;
+			}
+			++ fsyncs;
+			durableLSN = target;
+		}
+		return lsn <= target;
+	}
+	/*
+	 * 追加一条记录，内容为a的alen个字节加上b的blen个字节
+	 * 返回记录的LSN，出错时返回0
+	 */
+	ull appendLocked(uint type, const void* a, int alen, const void* b = NULL, int blen = 0) {
+		LogRecordHeader h;
+		h.length = sizeof(h) + alen + blen;
+		h.type = type;
+		if (used + (int)h.length > LOG_BUFFER_SIZE && !writeBufferLocked()) {
+			return 0;
+		}
+		uchar* p = buf + used;
+		memcpy(p, &h, sizeof(h));
+		if (alen > 0) {
+			memcpy(p + sizeof(h), a, alen);
+		}
+		if (blen > 0) {
+			memcpy(p + sizeof(h) + alen, b, blen);
+		}
+		h.crc = crc32c(p + 2 * sizeof(uint), h.length - 2 * sizeof(uint));
+		memcpy(p, &h, sizeof(h));
+		used += h.length;
+		nextLSN = bufLSN + used;
+		return nextLSN;
+	}
+	ull appendOpenLocked(int fileID) {
+		uint fileNo = fileNos[fileID];
+		return appendLocked(LOG_OPEN, &fileNo, sizeof(fileNo), paths[fileID].data(), paths[fileID].size());
+	}
+	static RedoPage* redoPage(RedoPages& pages, const std::string& path, int pageID) {
+		RedoPage*& page = pages[std::make_pair(path, pageID)];
+		if (page == nullptr) {
+			page = new RedoPage;
+			memset(page->covered, 0, PAGE_SIZE);
+		}
+		return page;
+	}
+	/*
+	 * 恢复时把pages中path的页面改为属于to，to为空时丢弃这些页面
+	 */
+	static void movePages(RedoPages& pages, const std::string& path, const std::string& to) {
+		std::vector<std::pair<int, RedoPage*>> moved;
+		for (auto it = pages.begin(); it != pages.end(); ) {
+			if (it->first.first == path) {
+				moved.push_back(std::make_pair(it->first.second, it->second));
+				it = pages.erase(it);
+			} else if (!to.empty() && it->first.first == to) {
+				// to原有的页面被改名覆盖
+				delete it->second;
+				it = pages.erase(it);
+			} else {
+				++ it;
+			}
+		}
+		for (auto& page : moved) {
+			if (to.empty()) {
+				delete page.second;
+			} else {
+				pages[std::make_pair(to, page.first)] = page.second;
+			}
+		}
+	}
+	/*
+	 * 重做一条LOG_UPDATE、LOG_RENAME或LOG_REMOVE记录
+	 * 改名和删除直接作用在文件上，页面的修改先留在pages中，最后由writePages写回
+	 */
+	static void redo(const uchar* rec, std::map<uint, std::string>& files, RedoPages& pages) {
+		LogRecordHeader h;
+		memcpy(&h, rec, sizeof(h));
+		const uchar* body = rec + sizeof(h);
+		int bodyLen = h.length - sizeof(h);
+		if (h.type == LOG_UPDATE) {
+			LogUpdateBody u;
+			memcpy(&u, body, sizeof(u));
+			auto it = files.find(u.fileNo);
+			if (it == files.end() || u.offset + u.length > PAGE_SIZE) {
+				printf("In LogManager::Recover, skipping a bad update record\n");
+				return;
+			}
+			RedoPage* page = redoPage(pages, it->second, u.pageID);
+			memcpy(page->data + u.offset, body + sizeof(u), u.length);
+			memset(page->covered + u.offset, 1, u.length);
+		} else if (h.type == LOG_RENAME) {
+			std::string from((const char*)body), to((const char*)body + strlen((const char*)body) + 1, bodyLen - strlen((const char*)body) - 1);
+			movePages(pages, from, to);
+			// 改名可能在崩溃之前已经完成了
+			if (access(from.data(), F_OK) == 0) {
+				PageChecksums::rename(from.data(), to.data());
+			}
+			for (auto& f : files) {
+				if (f.second == from) {
+					f.second = to;
+				}
+			}
+		} else if (h.type == LOG_REMOVE) {
+			std::string path((const char*)body, bodyLen);
+			movePages(pages, path, std::string());
+			PageChecksums::remove(path.data());
+		}
+	}
+	/*
+	 * 把恢复得到的页面写回文件，没有被日志记录覆盖的字节保持文件中原来的内容
+	 * 不存在的文件会被创建，写回的页面同时更新校验和
+	 * 校验和文件中记录为压缩的页面先解压，重做之后按原样写回，下一次写回时再压缩，不能解压的页面不重做，恢复失败
+	 */
+	static bool writePages(RedoPages& pages) {
+		bool ok = true;
+		std::string path;
+		int f = -1;
+		PageChecksums sums;
+		uint page[PAGE_INT_NUM];
+		BufType pageBuf = page;
+		uchar* bytes = (uchar*)page;
+		for (auto& item : pages) {
+			if (item.first.first != path) {
+				if (f >= 0) {
+					ok = fsync(f) == 0 && sums.sync() == 0 && ok;
+					close(f);
+				}
+				path = item.first.first;
+				f = open(path.data(), O_RDWR | O_CREAT, 0666);
+				if (f < 0) {
+					printf("In LogManager::Recover, cannot open %s\n", path.data());
+					sums.close();
+					ok = false;
+				} else if (!sums.open(path.data(), false)) {
+					printf("In LogManager::Recover, cannot open the page checksums of %s\n", path.data());
+					ok = false;
+				}
+			}
+			RedoPage* redoPage = item.second;
+			off_t offset = (off_t)item.first.second << PAGE_SIZE_IDX;
+			if (f >= 0) {
+				if (!rwAll(f, false, bytes, PAGE_SIZE, offset)) {
+					ok = false;
+				} else if (PageCompression::load(sums, item.first.second, bytes, bytes, false) < 0) {
+					// 不能在损坏的页面上重做，否则会给它记下新的校验和，之后读的时候发现不了，这个页面保持原样
+					printf("In LogManager::Recover, page %d of %s cannot be decompressed\n", item.first.second, path.data());
+					ok = false;
+				} else {
+					for (int i = 0; i < PAGE_SIZE; ++ i) {
+						if (redoPage->covered[i]) {
+							bytes[i] = redoPage->data[i];
+						}
+					}
+					if (sums.record(item.first.second, &pageBuf, 1) != 0) {
+						ok = false;
+					} else {
+						ok = rwAll(f, true, bytes, PAGE_SIZE, offset) && ok;
+					}
+				}
+			}
+			delete redoPage;
+		}
+		if (f >= 0) {
+			ok = fsync(f) == 0 && sums.sync() == 0 && ok;
+			close(f);
+		}
+		sums.close();
+		pages.clear();
+		return ok;
+	}
+public:
+	LogManager() {
+		fd = dirFd = -1;
+		void* p;
+		if (posix_memalign(&p, FILE_DIRECT_ALIGN, LOG_BUFFER_SIZE) != 0) {
+			p = malloc(LOG_BUFFER_SIZE);
+		}
+		buf = (uchar*)p;
+		used = 0;
+		bufLSN = baseLSN = 1;
+		checkpointLSN = redoLSN = 0;
+		punchedTo = LOG_HEADER_SIZE;
+		ddlPending = false;
+		nextLSN = durableLSN = 1;
+		broken = false;
+		syncing = false;
+		nextFileNo = 0;
+		commitDelay = LOG_COMMIT_DELAY;
+		const char* delay = getenv("DBMS_COMMIT_DELAY");
+		if (delay != NULL) {
+			commitDelay = atoi(delay) > 0 ? atoi(delay) : 0;
+		}
+		committers = 0;
+		commits = groupedCommits = fsyncs = writeBytes = checkpoints = 0;
+		openTime = std::chrono::steady_clock::now();
+		for (int i = 0; i < MAX_FILE_NUM; ++ i) {
+			fileNos[i] = -1;
+		}
+	}
+	~LogManager() {
+		if (fd >= 0) {
+			close(fd);
+		}
+		if (dirFd >= 0) {
+			close(dirFd);
+		}
+		free(buf);
+	}
+	/*
+	 * @函数名Open
+	 * @参数name:日志文件名，不存在时创建
+	 * 功能:打开日志文件，之后应该先调用Recover，再用Truncate清空日志，才能写新的记录
+	 * 返回:是否成功
+	 */
+	bool Open(const char* name) {
+		fd = open(name, O_RDWR | O_CREAT, 0666);
+		if (fd < 0) {
+			printf("In LogManager::Open, cannot open %s: %s\n", name, strerror(errno));
+			return false;
+		}
+		std::string dir(name);
+		size_t slash = dir.rfind('/');
+		dir = slash == std::string::npos ? "." : dir.substr(0, slash);
+		dirFd = open(dir.data(), O_RDONLY | O_DIRECTORY);
+		if (dirFd < 0) {
+			printf("In LogManager::Open, cannot open the directory of %s: %s\n", name, strerror(errno));
+			return false;
+		}
+		off_t size = lseek(fd, 0, SEEK_END);
+		LogFileHeader h;
+		if (size >= LOG_HEADER_SIZE && rwAll(fd, false, (uchar*)&h, sizeof(h), 0) && h.magic == MAGIC && h.version <= VERSION) {
+			// 版本1的文件头中没有检查点，这两项为0
+			baseLSN = h.baseLSN;
+			checkpointLSN = h.checkpointLSN;
+			redoLSN = h.redoLSN;
+		} else {
+			size = LOG_HEADER_SIZE;
+			baseLSN = 1;
+			if (!writeHeader() || ftruncate(fd, LOG_HEADER_SIZE) != 0) {
+				printf("In LogManager::Open, cannot initialize %s\n", name);
+				return false;
+			}
+		}
+		bufLSN = baseLSN + (size - LOG_HEADER_SIZE);
+		nextLSN = durableLSN = bufLSN;
+		return true;
+	}
+	/*
+	 * 读出检查点记录中的文件表，记录不完整时返回false
+	 */
+	static bool readCheckpoint(const uchar* rec, size_t size, std::map<uint, std::string>& files) {
+		LogRecordHeader h;
+		if (size < sizeof(h)) {
+			return false;
+		}
+		memcpy(&h, rec, sizeof(h));
+		if (h.type != LOG_CHECKPOINT || h.length > size || h.length < sizeof(h) + sizeof(ull) ||
+			crc32c(rec + 2 * sizeof(uint), h.length - 2 * sizeof(uint)) != h.crc) {
+			return false;
+		}
+		size_t pos = sizeof(h) + sizeof(ull);
+		while (pos + sizeof(uint) + sizeof(ushort) <= h.length) {
+			uint fileNo;
+			ushort len;
+			memcpy(&fileNo, rec + pos, sizeof(fileNo));
+			memcpy(&len, rec + pos + sizeof(fileNo), sizeof(len));
+			pos += sizeof(fileNo) + sizeof(len);
+			if (pos + len > h.length) {
+				return false;
+			}
+			files[fileNo] = std::string((const char*)rec + pos, len);
+			pos += len;
+		}
+		return true;
+	}
+	/*
+	 * @函数名Recover
+	 * 功能:重做日志中所有完整的组
+	 *           有检查点时从它的redoLSN开始，文件表先从检查点记录中读出，否则从日志开头开始
+	 *           记录按顺序读入，到第一条长度或校验和不对的记录为止，这之后是崩溃时没有写完的部分
+	 *           重做的页面写回并落盘，但日志不会被清空，之后需要调用Truncate
+	 * 返回:重做的组数，出错时返回-1
+	 */
+	int Recover() {
+		std::lock_guard<std::mutex> lock(latch);
+		off_t end = lseek(fd, 0, SEEK_END);
+		off_t start = LOG_HEADER_SIZE;
+		if (checkpointLSN != 0) {
+			if (redoLSN < baseLSN || redoLSN > checkpointLSN || fileOffset(checkpointLSN) >= end) {
+				printf("In LogManager::Recover, bad checkpoint in the log header\n");
+				return -1;
+			}
+			start = fileOffset(redoLSN);
+		}
+		if (end <= start) {
+			return 0;
+		}
+		size_t size = end - start;
+		uchar* data = (uchar*)malloc(size);
+		if (data == NULL || !rwAll(fd, false, data, size, start)) {
+			printf("In LogManager::Recover, cannot read the log\n");
+			free(data);
+			return -1;
+		}
+		std::map<uint, std::string> files;
+		if (checkpointLSN != 0 && !readCheckpoint(data + (checkpointLSN - redoLSN), size - (checkpointLSN - redoLSN), files)) {
+			printf("In LogManager::Recover, cannot read the checkpoint record\n");
+			free(data);
+			return -1;
+		}
+		RedoPages pages;
+		std::vector<size_t> group;
+		int groups = 0;
+		size_t pos = 0;
+		while (pos + sizeof(LogRecordHeader) <= size) {
+			LogRecordHeader h;
+			memcpy(&h, data + pos, sizeof(h));
+			if (h.length < sizeof(h) || h.length > size - pos || crc32c(data + pos + 2 * sizeof(uint), h.length - 2 * sizeof(uint)) != h.crc) {
+				break;
+			}
+			if (h.type == LOG_OPEN) {
+				uint fileNo;
+				memcpy(&fileNo, data + pos + sizeof(h), sizeof(fileNo));
+				files[fileNo] = std::string((const char*)data + pos + sizeof(h) + sizeof(fileNo), h.length - sizeof(h) - sizeof(fileNo));
+			} else if (h.type == LOG_END) {
+				for (size_t rec : group) {
+					redo(data + rec, files, pages);
+				}
+				group.clear();
+				++ groups;
+			} else if (h.type != LOG_CHECKPOINT) {
+				// 检查点记录可能出现在一组记录的中间，它的文件表已经在开始时读出
+				group.push_back(pos);
+			}
+			pos += h.length;
+		}
+		free(data);
+		if (!group.empty() || pos < size) {
+			printf("In LogManager::Recover, discarding %zu bytes of incomplete log\n", size - (group.empty() ? pos : group[0]));
+		}
+		if (!writePages(pages)) {
+			printf("In LogManager::Recover, cannot write back recovered pages\n");
+			return -1;
+		}
+		return groups;
+	}
+	/*
+	 * @函数名Truncate
+	 * 功能:清空日志，已经打开的文件重新写一条LOG_OPEN
+	 *           调用前日志中的修改必须已经全部写回文件(比如BufPageManager::flushAll之后)，这里会先把它们落盘
+	 * 返回:是否成功
+	 */
+	bool Truncate() {
+		std::unique_lock<std::mutex> sync(syncLatch);
+		while (syncing) {
+			synced.wait(sync);
+		}
+		std::lock_guard<std::mutex> lock(latch);
+		if (!syncData()) {
+			printf("In LogManager::Truncate, cannot sync the data files: %s\n", strerror(errno));
+			return false;
+		}
+		baseLSN = bufLSN = nextLSN;
+		checkpointLSN = redoLSN = 0;
+		punchedTo = LOG_HEADER_SIZE;
+		ddlPending = false;
+		used = 0;
+		if (!writeHeader() || ftruncate(fd, LOG_HEADER_SIZE) != 0 || fdatasync(fd) != 0) {
+			printf("In LogManager::Truncate, cannot truncate the log\n");
+			broken = true;
+			return false;
+		}
+		++ fsyncs;
+		durableLSN = nextLSN.load();
+		fileNoOf.clear();
+		for (int i = 0; i < MAX_FILE_NUM; ++ i) {
+			if (fileNos[i] >= 0) {
+				fileNoOf[paths[i]] = fileNos[i];
+				appendOpenLocked(i);
+			}
+		}
+		return true;
+	}
+	/*
+	 * @函数名Checkpoint
+	 * @参数redoLSN:恢复开始的位置，这之前的记录修改过的页面都已经写回文件(还没有落盘)
+	 * 功能:模糊检查点，不需要写回所有脏页，也不阻塞修改数据库的线程
+	 *           先把已经写回的页面落盘，再写一条检查点记录，记录中有redoLSN和文件表，落盘后更新文件头
+	 *           之后恢复从redoLSN开始，redoLSN所在的LOG_SEGMENT_SIZE字节的段之前的日志空间被释放(文件大小不变)
+	 *           上次Truncate之后改名或删除过文件时跳过，这时Truncate很快就会清空日志
+	 * 返回:是否成功，跳过时也返回true
+	 */
+	bool Checkpoint(ull redoLSN) {
+		if (!syncData()) {
+			printf("In LogManager::Checkpoint, cannot sync the data files: %s\n", strerror(errno));
+			return false;
+		}
+		{
+			std::unique_lock<std::mutex> sync(syncLatch);
+			while (syncing) {
+				synced.wait(sync);
+			}
+			syncing = true;
+		}
+		ull start, target;
+		bool ok = false;
+		{
+			std::lock_guard<std::mutex> lock(latch);
+			// 调用者计算redoLSN之后日志被清空过，这个检查点已经没有意义
+			if (broken || ddlPending || redoLSN < baseLSN || redoLSN <= this->redoLSN) {
+				ok = !broken;
+				start = 0;
+			} else {
+				std::string body((const char*)&redoLSN, sizeof(redoLSN));
+				for (auto& f : fileNoOf) {
+					ushort len = f.first.size();
+					body.append((const char*)&f.second, sizeof(f.second));
+					body.append((const char*)&len, sizeof(len));
+					body.append(f.first);
+				}
+				start = nextLSN.load();
+				ok = appendLocked(LOG_CHECKPOINT, body.data(), body.size()) != 0 && writeBufferLocked();
+				target = bufLSN;
+			}
+		}
+		if (ok && start != 0) {
+			ok = fdatasync(fd) == 0;
+			if (ok) {
+				++ fsyncs;
+				durableLSN = target;
+				std::lock_guard<std::mutex> lock(latch);
+				checkpointLSN = start;
+				this->redoLSN = redoLSN;
+				ok = writeHeader() && fdatasync(fd) == 0;
+				if (ok) {
+					++ fsyncs;
+					++ checkpoints;
+					// 释放整段的空间，不支持打洞的文件系统上只是不释放
+					off_t to = fileOffset(redoLSN) / LOG_SEGMENT_SIZE * LOG_SEGMENT_SIZE;
+					if (to > punchedTo && fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, punchedTo, to - punchedTo) == 0) {
+						punchedTo = to;
+					}
+				}
+			}
+			if (!ok) {
+				printf("In LogManager::Checkpoint, cannot write the checkpoint: %s\n", strerror(errno));
+				std::lock_guard<std::mutex> lock(latch);
+				broken = true;
+			}
+		}
+		endSync();
+		return ok;
+	}
+	/*
+	 * @函数名Attach
+	 * @参数fileID:文件id
+	 * @参数path:文件路径，恢复时用它找到文件
+	 * 功能:之后对fileID的修改写日志
+	 */
+	void Attach(int fileID, const char* path) {
+		std::lock_guard<std::mutex> lock(latch);
+		auto it = fileNoOf.find(path);
+		if (it == fileNoOf.end()) {
+			it = fileNoOf.insert(std::make_pair(std::string(path), nextFileNo++)).first;
+		}
+		fileNos[fileID] = it->second;
+		paths[fileID] = path;
+		appendOpenLocked(fileID);
+	}
+	/*
+	 * @函数名Detach
+	 * @参数fileID:文件id
+	 * 功能:文件关闭前调用，之后fileID可以被复用
+	 */
+	void Detach(int fileID) {
+		std::lock_guard<std::mutex> lock(latch);
+		fileNos[fileID] = -1;
+		paths[fileID].clear();
+	}
+	bool IsAttached(int fileID) {
+		return fileNos[fileID] >= 0;
+	}
+	/*
+	 * @函数名LogUpdate
+	 * @参数fileID:文件id，必须已经Attach
+	 * @参数pageID:文件页号
+	 * @参数offset:修改在页面中开始的位置
+	 * @参数length:修改的字节数
+	 * @参数data:修改后的内容
+	 * 返回:记录的LSN，出错时返回0
+	 */
+	ull LogUpdate(int fileID, int pageID, int offset, int length, const void* data) {
+		std::lock_guard<std::mutex> lock(latch);
+		LogUpdateBody u;
+		u.fileNo = fileNos[fileID];
+		u.pageID = pageID;
+		u.offset = offset;
+		u.length = length;
+		return appendLocked(LOG_UPDATE, &u, sizeof(u), data, length);
+	}
+	ull LogRename(const char* from, const char* to) {
+		std::lock_guard<std::mutex> lock(latch);
+		auto it = fileNoOf.find(from);
+		if (it != fileNoOf.end() && it->first != to) {
+			uint fileNo = it->second;
+			fileNoOf.erase(it);
+			fileNoOf[to] = fileNo;
+		}
+		ddlPending = true;
+		return appendLocked(LOG_RENAME, from, strlen(from) + 1, to, strlen(to));
+	}
+	ull LogRemove(const char* path) {
+		std::lock_guard<std::mutex> lock(latch);
+		fileNoOf.erase(path);
+		ddlPending = true;
+		return appendLocked(LOG_REMOVE, path, strlen(path));
+	}
+	/*
+	 * @函数名LogEnd
+	 * 功能:结束当前的一组记录，见BufPageManager::endGroup
+	 * 返回:END记录的LSN，组内修改过的页面在日志落盘到这里之前不能写回
+	 */
+	ull LogEnd() {
+		std::lock_guard<std::mutex> lock(latch);
+		return appendLocked(LOG_END, NULL, 0);
+	}
+	/*
+	 * @函数名FlushTo
+	 * @参数lsn:日志位置
+	 * 功能:保证lsn之前的记录已经落盘，缓冲区中的记录全部写入日志文件后fdatasync
+	 *           页面写回之前调用，不等待提交延迟
+	 * 返回:是否成功，失败时对应的页面不能写回
+	 */
+	bool FlushTo(ull lsn) {
+		if (lsn <= durableLSN.load()) {
+			return true;
+		}
+		{
+			std::unique_lock<std::mutex> sync(syncLatch);
+			if (waitSync(sync, lsn)) {
+				return true;
+			}
+		}
+		bool ok = syncTo(lsn);
+		endSync();
+		return ok;
+	}
+	/*
+	 * @函数名Flush
+	 * 功能:把所有记录落盘
+	 */
+	bool Flush() {
+		return FlushTo(nextLSN.load());
+	}
+	/*
+	 * @函数名Commit
+	 * 功能:语句结束时调用，之后语句的修改不会因为崩溃而丢失
+	 *           多个线程同时提交时只有一个线程fdatasync，其余的等它完成后发现自己的记录已经落盘，直接返回
+	 *           有其他线程也在提交时，负责同步的线程先等待commitDelay微秒，让更多的提交赶上这一次同步
+	 * 返回:是否成功
+	 */
+	bool Commit() {
+		ull lsn = nextLSN.load();
+		++ commits;
+		if (lsn <= durableLSN.load()) {
+			++ groupedCommits;
+			return true;
+		}
+		++ committers;
+		{
+			std::unique_lock<std::mutex> sync(syncLatch);
+			if (waitSync(sync, lsn)) {
+				++ groupedCommits;
+				-- committers;
+				return true;
+			}
+		}
+		if (commitDelay > 0 && committers.load() > 1) {
+			std::this_thread::sleep_for(std::chrono::microseconds(commitDelay));
+		}
+		bool ok = syncTo(lsn);
+		-- committers;
+		endSync();
+		return ok;
+	}
+	/*
+	 * @函数名SetCommitDelay
+	 * @参数us:提交延迟(微秒)，为0时不等待
+	 */
+	void SetCommitDelay(int us) {
+		commitDelay = us > 0 ? us : 0;
+	}
+	int CommitDelay() {
+		return commitDelay;
+	}
+	LogStats GetStats() {
+		LogStats st;
+		st.commits = commits.load();
+		st.groupedCommits = groupedCommits.load();
+		st.fsyncs = fsyncs.load();
+		st.writeBytes = writeBytes.load();
+		st.checkpoints = checkpoints.load();
+		st.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - openTime).count();
+		return st;
+	}
+	ull CurrentLSN() {
+		return nextLSN.load();
+	}
+	/*
+	 * 返回:恢复时需要读的日志字节数，即最近一次检查点的redoLSN(没有检查点时为日志开头)之后的部分
+	 */
+	ull Size() {
+		std::lock_guard<std::mutex> lock(latch);
+		return nextLSN.load() - (redoLSN != 0 ? redoLSN : baseLSN);
+	}
+};
+#endif
@@ -0,0 +1,157 @@
+#ifndef BIT_SCAN_H
+#define BIT_SCAN_H
+#include <string.h>
+#include "pagedef.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIT_SCAN_X86 1
+#else
+#define BIT_SCAN_X86 0
+#endif
+/*
+ * 位图扫描和批量置位
+ * 位图中第i位在第i/8个字节中，从字节的最高位开始(0x80 >> (i % 8))，和Table中的位图相同
+ * 每次读8个字节转成大端的64位整数，第一位在最高位，用__builtin_clzll找第一个1，不再逐位判断
+ * CPU支持AVX2时先每次比较32个字节，跳过全0(找0时跳过全1)的部分
+ */
+inline ull bitScanLoad(const uchar* p) {
+	ull w;
+	memcpy(&w, p, 8);
+	return __builtin_bswap64(w);
+}
+#if BIT_SCAN_X86
+/*
+ * @函数名bitSkipAvx2
+ * 功能:从第byte个字节开始每次比较32个字节，跳过所有字节都等于skip的块，最多到第end个字节
+ *           只能在bitScanHasAvx2返回true时调用
+ * 返回:第一个不能跳过的块的开始位置
+ */
+__attribute__((target("avx2"))) inline int bitSkipAvx2(const uchar* p, int byte, int end, uchar skip) {
+	__m256i pattern = _mm256_set1_epi8((char)skip);
+	for (; byte + 32 <= end; byte += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)(p + byte));
+		if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, pattern)) != -1) {
+			break;
+		}
+	}
+	return byte;
+}
+#endif
+/*
+ * @函数名bitScanHasAvx2
+ * 返回:是否使用AVX2跳过，在第一次调用时检测
+ */
+inline bool bitScanHasAvx2() {
+#if BIT_SCAN_X86
+	static const bool has = __builtin_cpu_supports("avx2");
+	return has;
+#else
+	return false;
+#endif
+}
+/*
+ * 从第from位开始的一个字(最多64位，不超过to)，第from位在最高位，flip为~0时按位取反
+ * bits返回这个字包含的位数，不包含的低位都是0
+ */
+inline ull _bitScanWord(const uchar* p, int from, int to, ull flip, int& bits) {
+	int byte = from >> 3, end = (to + 7) >> 3;
+	ull w;
+	if (byte + 8 <= end) {
+		w = bitScanLoad(p + byte) ^ flip;
+		bits = 64;
+	} else {
+		w = 0;
+		for (int k = byte; k < end; ++ k) {
+			w |= (ull)(uchar)(p[k] ^ flip) << (56 - ((k - byte) << 3));
+		}
+		bits = (end - byte) << 3;
+	}
+	w <<= from & 7;
+	bits -= from & 7;
+	if (bits > to - from) {
+		bits = to - from;
+	}
+	if (bits < 64) {
+		w &= ~0ULL << (64 - bits);
+	}
+	return w;
+}
+/*
+ * 按字节对齐并且剩下至少64个字节时，用AVX2跳过全是skip的块，返回跳过之后的位置
+ */
+inline int _bitScanSkip(const uchar* p, int from, int to, uchar skip) {
+#if BIT_SCAN_X86
+	if ((from & 7) == 0 && (to >> 3) - (from >> 3) >= 64 && bitScanHasAvx2()) {
+		return bitSkipAvx2(p, from >> 3, to >> 3, skip) << 3;
+	}
+#endif
+	return from;
+}
+/*
+ * @函数名bitScanFirst
+ * @参数p:位图
+ * @参数from, to:查找的范围[from, to)，按位计
+ * @参数one:为true时找1，否则找0
+ * 返回:范围中第一个值为one的位的下标，没有时返回-1
+ */
+inline int bitScanFirst(const uchar* p, int from, int to, bool one) {
+	ull flip = one ? 0 : ~0ULL;
+	while (from < to) {
+		from = _bitScanSkip(p, from, to, one ? 0 : 0xff);
+		if (from >= to) {
+			break;
+		}
+		int bits;
+		ull w = _bitScanWord(p, from, to, flip, bits);
+		if (w != 0) {
+			return from + __builtin_clzll(w);
+		}
+		from += bits;
+	}
+	return -1;
+}
+/*
+ * @函数名bitScanCollect
+ * @参数p:位图
+ * @参数from, to:查找的范围[from, to)，按位计
+ * @参数base:第from位对应的编号
+ * @参数out:输出，第i位为1时依次放入base + i - from，至少能放to - from个
+ * 返回:为1的位的个数
+ */
+inline int bitScanCollect(const uchar* p, int from, int to, uint base, uint* out) {
+	int n = 0;
+	base -= from;
+	while (from < to) {
+		from = _bitScanSkip(p, from, to, 0);
+		if (from >= to) {
+			break;
+		}
+		int bits;
+		ull w = _bitScanWord(p, from, to, 0, bits);
+		while (w != 0) {
+			int c = __builtin_clzll(w);
+			out[n++] = base + from + c;
+			w &= ~(0x8000000000000000ULL >> c);
+		}
+		from += bits;
+	}
+	return n;
+}
+/*
+ * @函数名bitFill
+ * 功能:把位[from, to)都置为1，中间的整字节直接memset
+ */
+inline void bitFill(uchar* p, int from, int to) {
+	for (; from < to && (from & 7) != 0; ++ from) {
+		p[from >> 3] |= 0x80 >> (from & 7);
+	}
+	int bytes = (to >> 3) - (from >> 3);
+	if (bytes > 0) {
+		memset(p + (from >> 3), 0xff, bytes);
+		from += bytes << 3;
+	}
+	for (; from < to; ++ from) {
+		p[from >> 3] |= 0x80 >> (from & 7);
+	}
+}
+#endif
@@ -0,0 +1,96 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+#include <stddef.h>
+#include <string.h>
+#include "pagedef.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_X86 1
+#else
+#define CRC32C_X86 0
+#endif
+/*
+ * CRC32C(Castagnoli多项式，反射形式0x82F63B78)
+ * CPU支持SSE4.2时用crc32指令每次处理8个字节，否则按字节查表计算，两者的结果相同
+ */
+struct CRC32CTable {
+	uint t[256];
+	CRC32CTable() {
+		for (uint i = 0; i < 256; ++ i) {
+			uint c = i;
+			for (int k = 0; k < 8; ++ k) {
+				c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+			}
+			t[i] = c;
+		}
+	}
+};
+/*
+ * @函数名crc32cSoftware
+ * 功能:查表计算，表在第一次调用时生成，参数和返回值同crc32c
+ */
+inline uint crc32cSoftware(const void* data, size_t n, uint crc = 0) {
+	static const CRC32CTable table;
+	const uchar* p = (const uchar*)data;
+	crc = ~crc;
+	for (size_t i = 0; i < n; ++ i) {
+		crc = table.t[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+#if CRC32C_X86
+/*
+ * @函数名crc32cHardware
+ * 功能:用SSE4.2的crc32指令计算，只能在crc32cHasHardware返回true时调用，参数和返回值同crc32c
+ */
+__attribute__((target("sse4.2"))) inline uint crc32cHardware(const void* data, size_t n, uint crc = 0) {
+	const uchar* p = (const uchar*)data;
+	crc = ~crc;
+#if defined(__x86_64__)
+	ull c = crc;
+	for (; n >= 8; n -= 8, p += 8) {
+		ull v;
+		memcpy(&v, p, 8);
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = (uint)c;
+#endif
+	for (; n >= 4; n -= 4, p += 4) {
+		uint v;
+		memcpy(&v, p, 4);
+		crc = _mm_crc32_u32(crc, v);
+	}
+	for (; n > 0; -- n, ++ p) {
+		crc = _mm_crc32_u8(crc, *p);
+	}
+	return ~crc;
+}
+#endif
+/*
+ * @函数名crc32cHasHardware
+ * 返回:是否使用SSE4.2计算，在第一次调用时检测
+ */
+inline bool crc32cHasHardware() {
+#if CRC32C_X86
+	static const bool has = __builtin_cpu_supports("sse4.2");
+	return has;
+#else
+	return false;
+#endif
+}
+/*
+ * @函数名crc32c
+ * @参数data:数据的首地址
+ * @参数n:数据的字节数
+ * @参数crc:之前部分的校验和，分段计算时传入上一段的结果
+ * 返回:data中n个字节的CRC32C
+ */
+inline uint crc32c(const void* data, size_t n, uint crc = 0) {
+#if CRC32C_X86
+	if (crc32cHasHardware()) {
+		return crc32cHardware(data, n, crc);
+	}
+#endif
+	return crc32cSoftware(data, n, crc);
+}
+#endif
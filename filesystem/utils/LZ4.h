@@ -0,0 +1,204 @@
+#ifndef LZ4_H
+#define LZ4_H
+#include <string.h>
+#include "pagedef.h"
+/*
+ * LZ4块格式的压缩和解压，和liblz4的LZ4_compress_default/LZ4_decompress_safe的格式相同
+ * 只用于压缩单个页面这样的小块数据，不支持流式压缩和字典
+ * 每个序列由一个token字节(高4位为字面量长度，低4位为匹配长度-4，为15时后面跟着255...的扩展字节)、字面量、
+ * 2字节的小端偏移和匹配长度的扩展字节组成，最后一个序列只有字面量
+ */
+struct LZ4 {
+	static const int MIN_MATCH = 4;
+	// 最后5个字节总是字面量，最后一个匹配至少在结尾之前12个字节开始
+	static const int LAST_LITERALS = 5;
+	static const int MF_LIMIT = 12;
+	static const int HASH_LOG = 12;
+	static const int MAX_OFFSET = 65535;
+	static uint _read32(const uchar* p) {
+		uint v;
+		memcpy(&v, p, 4);
+		return v;
+	}
+	static ull _read64(const uchar* p) {
+		ull v;
+		memcpy(&v, p, 8);
+		return v;
+	}
+	static uint _hash(uint v) {
+		return (v * 2654435761u) >> (32 - HASH_LOG);
+	}
+	// 写入长度的扩展字节，返回写入后的位置，超出end时返回NULL
+	static uchar* _putLength(uchar* op, uchar* end, int len) {
+		for (; len >= 255; len -= 255) {
+			if (op >= end) {
+				return NULL;
+			}
+			*op++ = 255;
+		}
+		if (op >= end) {
+			return NULL;
+		}
+		*op++ = (uchar)len;
+		return op;
+	}
+	/*
+	 * @函数名compress
+	 * @参数src:要压缩的n个字节
+	 * @参数dst:输出缓存，大小为cap
+	 * 返回:压缩后的字节数，放不进cap个字节时返回0
+	 */
+	static int compress(const uchar* src, int n, uchar* dst, int cap) {
+		int table[1 << HASH_LOG];
+		memset(table, -1, sizeof(table));
+		uchar* op = dst;
+		uchar* end = dst + cap;
+		int ip = 0, anchor = 0;
+		int matchLimit = n - LAST_LITERALS;
+		while (ip <= n - MF_LIMIT) {
+			uint h = _hash(_read32(src + ip));
+			int ref = table[h];
+			table[h] = ip;
+			if (ref < 0 || ip - ref > MAX_OFFSET || _read32(src + ref) != _read32(src + ip)) {
+				// 越久没有找到匹配，跳得越远，不可压缩的数据很快结束
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+			while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+				-- ip;
+				-- ref;
+			}
+			int len = MIN_MATCH;
+			while (ip + len + 8 <= matchLimit) {
+				ull diff = _read64(src + ip + len) ^ _read64(src + ref + len);
+				if (diff != 0) {
+					len += __builtin_ctzll(diff) >> 3;
+					goto found;
+				}
+				len += 8;
+			}
+			while (ip + len < matchLimit && src[ip + len] == src[ref + len]) {
+				++ len;
+			}
+		found:
+			int literals = ip - anchor;
+			if (end - op < 1 + literals + 2) {
+				return 0;
+			}
+			uchar* token = op++;
+			if (literals >= 15) {
+				*token = 15 << 4;
+				if ((op = _putLength(op, end, literals - 15)) == NULL || end - op < literals + 2) {
+					return 0;
+				}
+			} else {
+				*token = literals << 4;
+			}
+			memcpy(op, src + anchor, literals);
+			op += literals;
+			int offset = ip - ref;
+			*op++ = offset & 0xff;
+			*op++ = offset >> 8;
+			if (len - MIN_MATCH >= 15) {
+				*token |= 15;
+				if ((op = _putLength(op, end, len - MIN_MATCH - 15)) == NULL) {
+					return 0;
+				}
+			} else {
+				*token |= len - MIN_MATCH;
+			}
+			ip += len;
+			anchor = ip;
+			if (ip - 2 >= 0 && ip - 2 <= n - 4) {
+				table[_hash(_read32(src + ip - 2))] = ip - 2;
+			}
+		}
+		int literals = n - anchor;
+		if (op >= end) {
+			return 0;
+		}
+		uchar* token = op++;
+		if (literals >= 15) {
+			*token = 15 << 4;
+			if ((op = _putLength(op, end, literals - 15)) == NULL) {
+				return 0;
+			}
+		} else {
+			*token = literals << 4;
+		}
+		if (end - op < literals) {
+			return 0;
+		}
+		memcpy(op, src + anchor, literals);
+		op += literals;
+		return op - dst;
+	}
+	/*
+	 * @函数名decompress
+	 * @参数src:压缩后的n个字节
+	 * @参数dst:输出缓存，大小为cap
+	 * 返回:解压后的字节数，数据损坏或者放不进cap个字节时返回-1
+	 */
+	static int decompress(const uchar* src, int n, uchar* dst, int cap) {
+		int ip = 0, op = 0;
+		while (ip < n) {
+			int token = src[ip++];
+			int literals = token >> 4;
+			if (literals == 15) {
+				int b;
+				do {
+					if (ip >= n) {
+						return -1;
+					}
+					b = src[ip++];
+					literals += b;
+				} while (b == 255);
+			}
+			if (literals > n - ip || literals > cap - op) {
+				return -1;
+			}
+			memcpy(dst + op, src + ip, literals);
+			ip += literals;
+			op += literals;
+			if (ip == n) {
+				break;
+			}
+			if (n - ip < 2) {
+				return -1;
+			}
+			int offset = src[ip] | (src[ip + 1] << 8);
+			ip += 2;
+			if (offset == 0 || offset > op) {
+				return -1;
+			}
+			int len = token & 15;
+			if (len == 15) {
+				int b;
+				do {
+					if (ip >= n) {
+						return -1;
+					}
+					b = src[ip++];
+					len += b;
+				} while (b == 255);
+			}
+			len += MIN_MATCH;
+			if (len > cap - op) {
+				return -1;
+			}
+			uchar* out = dst + op;
+			const uchar* from = out - offset;
+			if (offset >= len) {
+				memcpy(out, from, len);
+			} else {
+				// 重叠的匹配，比如一长串相同的字节，逐个复制
+				for (int i = 0; i < len; ++ i) {
+					out[i] = from[i];
+				}
+			}
+			op += len;
+		}
+		return op;
+	}
+};
+#endif
@@ -0,0 +1,134 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+#include "pagedef.h"
+/*
+ * PageTable
+ * 缓存页面的hash表，由(fileID,pageID)找到缓存页面数组中的下标，接口与MyHashMap相同
+ * 开放定址，线性探测，删除时向前移动后面的元素(backward shift)，不需要墓碑
+ * 键值(fileID,pageID)打包为一个64位整数，经过混合函数后取低位作为槽号
+ * 槽的个数是不小于2c的2的幂，负载因子不超过0.5，探测序列很短，而且都在连续的内存中
+ */
+class PageTable {
+private:
+	static const ull EMPTY = ~0ull;
+	int CAP_;
+	uint mask;
+	/*
+	 * 槽，存放缓存页面的下标，-1表示空槽
+	 */
+	int* slots;
+	/*
+	 * 每个缓存页面的键值和它所在的槽
+	 */
+	ull* keys;
+	uint* slotOf;
+	static ull pack(int k1, int k2) {
+		return ((ull)(uint)k1 << 32) | (uint)k2;
+	}
+	/*
+	 * splitmix64的混合函数，相邻页号也会被分散到不同的槽中
+	 */
+	static ull mix(ull x) {
+		x ^= x >> 30;
+		x *= 0xbf58476d1ce4e5b9ull;
+		x ^= x >> 27;
+		x *= 0x94d049bb133111ebull;
+		x ^= x >> 31;
+		return x;
+	}
+	uint home(ull key) {
+		return (uint)mix(key) & mask;
+	}
+public:
+	/*
+	 * @函数名findIndex
+	 * @参数k1:fileID
+	 * @参数k2:pageID
+	 * 返回:(k1,k2)对应的缓存页面的下标，不存在时返回-1
+	 */
+	int findIndex(int k1, int k2) {
+		ull key = pack(k1, k2);
+		for (uint i = home(key); slots[i] != -1; i = (i + 1) & mask) {
+			if (keys[slots[i]] == key) {
+				return slots[i];
+			}
+		}
+		return -1;
+	}
+	/*
+	 * @函数名replace
+	 * @参数index:缓存页面的下标
+	 * 功能:第index个缓存页面改为存放(k1,k2)，原来的键值被移除
+	 */
+	void replace(int index, int k1, int k2) {
+		remove(index);
+		ull key = pack(k1, k2);
+		uint i = home(key);
+		while (slots[i] != -1) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = index;
+		slotOf[index] = i;
+		keys[index] = key;
+	}
+	/*
+	 * @函数名remove
+	 * @参数index:缓存页面的下标
+	 * 功能:移除第index个缓存页面的键值，它之后同一探测序列上的元素向前移动填补空槽
+	 */
+	void remove(int index) {
+		if (keys[index] == EMPTY) {
+			return;
+		}
+		uint hole = slotOf[index];
+		slots[hole] = -1;
+		keys[index] = EMPTY;
+		for (uint j = (hole + 1) & mask; slots[j] != -1; j = (j + 1) & mask) {
+			uint h = home(keys[slots[j]]);
+			// 如果h不在(hole, j]中，说明slots[j]的探测序列经过hole，可以移到hole
+			bool stay = hole < j ? (h > hole && h <= j) : (h > hole || h <= j);
+			if (!stay) {
+				slots[hole] = slots[j];
+				slotOf[slots[hole]] = hole;
+				slots[j] = -1;
+				hole = j;
+			}
+		}
+	}
+	/*
+	 * @函数名getKeys
+	 * 功能:取出第index个缓存页面的键值，页面为空时都为-1
+	 */
+	void getKeys(int index, int& k1, int& k2) {
+		k1 = (int)(keys[index] >> 32);
+		k2 = (int)(uint)keys[index];
+	}
+	/*
+	 * 构造函数
+	 * @参数c:缓存页面的个数
+	 */
+	PageTable(int c) {
+		CAP_ = c;
+		uint n = 1;
+		while (n < (uint)c * 2) {
+			n <<= 1;
+		}
+		mask = n - 1;
+		slots = new int[n];
+		for (uint i = 0; i < n; ++ i) {
+			slots[i] = -1;
+		}
+		keys = new ull[c];
+		slotOf = new uint[c];
+		for (int i = 0; i < CAP_; ++ i) {
+			keys[i] = EMPTY;
+			slotOf[i] = 0;
+		}
+	}
+	~PageTable() {
+		delete[] slots;
+		delete[] keys;
+		delete[] slotOf;
+	}
+};
+#endif
@@ -1,132 +1,230 @@
-#ifndef PAGE_DEF
-#define PAGE_DEF
-#include <unistd.h>
-#include <errno.h>
-#include <stdio.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <dirent.h>
-/*
- * 一个页面中的字节数
- */
-#define PAGE_SIZE 8192
-/*
- * 一个页面中的整数个数
- */
-#define PAGE_INT_NUM 2048
-/*
- * 页面字节数以2为底的指数
- */
-#define PAGE_SIZE_IDX 13
-#define MAX_FMT_INT_NUM 128
-//#define BUF_PAGE_NUM 65536
-#define MAX_FILE_NUM 128
-#define MAX_TYPE_NUM 256
-/*
- * 缓存中页面个数上限
- */
-#define CAP 60000
-/*
- * hash算法的模
- */
-#define MOD 60000
-#define IN_DEBUG 0
-#define DEBUG_DELETE 0
-#define DEBUG_ERASE 1
-#define DEBUG_NEXT 1
-/**
- * 记录页的起始下标,在这之前都是位图页
-*/
-#define START_PAGE 15
-/**
- * 一个表中列的上限
- */
-#define MAX_COL_NUM 31
-/**
- * 表示对应的column为null
-*/
-#define COL_ID_NONE 31
-/**
- * 数据库中表的个数上限
- * 为什么是31而非32: 为null留一个编码,表示非0-30号表中的任一个
- */
-#define MAX_TB_NUM 31
-/**
- * 表示对应的table为null
-*/
-#define TB_ID_NONE 31
-
-//below macros are added by msh
-/**
- * Max string length for an attribute
-*/
-#define MAX_ATTRI_NAME_LEN 32
-/**
- * Max string length for a database name
-*/
-#define MAX_DB_NAME_LEN 32
-/**
- * Max string length for a table name
-*/
-#define MAX_TABLE_NAME_LEN 32
-/**
- * Max string length for a constraint
-*/
-#define MAX_CONSTRAINT_NAME_LEN 16
-/**
- * Max times a table can be referrenced as a foreign key source
-*/
-#define MAX_FK_MASTER_TIME 30
-/**
- * Max number of foreign key constraints a table can have
-*/
-#define MAX_REF_SLAVE_TIME 16
-/**
- * Length of fragments to break varchar into, total length = 502 + 10 = 512 B
-*/
-#define VARCHAR_RECORD_LEN 512
-/**
- * Max number of indexes a table can have
-*/
-#define MAX_INDEX_NUM 16
-/**
- * Indicates an invalid index id
-*/
-#define INDEX_ID_NONE 16
-/**
- * Max string length for a index
-*/
-#define MAX_INDEX_NAME_LEN 16
-
-#define VARCHAR_FRAG_LEN (VARCHAR_RECORD_LEN - 10)
-
-#define DBMS_RESERVED_TABLE_NAME "ALL_DB"
-#define DB_RESERVED_TABLE_NAME "ALL_TB"
-#define IDX_RESERVED_TABLE_NAME "BPTREE"
-#define VARCHAR_RESERVED_TABLE_NAME "VARCHAR"
-#define TMP_RESERVED_TABLE_NAME "TMP"
-#define PRIMARY_RESERVED_IDX_NAME "PRMIARY_INDEX"
-
-/**
- * table中最多容纳buftracker的个数
-*/
-#define MAX_TABLE_BUF_SIZE 100
-
-#define DEBUG // If this macro is set, debug methods are available
-
-#define RELEASE 1
-typedef unsigned int* BufType;
-typedef unsigned int uint;
-typedef unsigned short ushort;
-// use uchar instead of char when manipulating bytes for efficiency and safety pls
-// use char only when dealing with strings
-typedef unsigned char uchar; 
-typedef unsigned long long ull;
-typedef long long ll;
-typedef double db;
-typedef int INT;
-typedef int(cf)(uchar*, uchar*);
-// what the hell are these ?
-// int current = 0;
-// int tt = 0;
-#endif
+#ifndef PAGE_DEF
+#define PAGE_DEF
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+/*
+ * 一个页面中的字节数
+ */
+#define PAGE_SIZE 8192
+/*
+ * 一个页面中的整数个数
+ */
+#define PAGE_INT_NUM 2048
+/*
+ * 页面字节数以2为底的指数
+ */
+#define PAGE_SIZE_IDX 13
+#define MAX_FMT_INT_NUM 128
+//#define BUF_PAGE_NUM 65536
+#define MAX_FILE_NUM 128
+#define MAX_TYPE_NUM 256
+/*
+ * 批量读写，见AsyncIO
+ * FILE_USE_IO_URING: 为1时使用io_uring同时提交一批读写请求，内核不支持时自动退回同步读写
+ * FILE_IO_DEPTH: 一个AsyncIO同时在设备上的请求数上限
+ */
+#define FILE_USE_IO_URING 1
+#define FILE_IO_DEPTH 64
+/*
+ * FILE_DIRECT_IO: 为1时以读写方式打开的文件使用O_DIRECT，绕过内核的页缓存，页面只在缓存管理器中有一份
+ *           这时缓存可以占用大部分内存，用DBMS_BUFFER_MB设置。启动时设置了环境变量DBMS_DIRECT_IO(0或1)时由它决定
+ * FILE_DIRECT_ALIGN: O_DIRECT要求读写的内存地址按它对齐，没有对齐的缓存先复制到对齐的临时缓存中再读写
+ */
+#define FILE_DIRECT_IO 0
+#define FILE_DIRECT_ALIGN 4096
+/*
+ * 按区段预先分配文件空间，见FileManager::_reserve
+ * 写到已经分配的位置之后时，用fallocate一次分配一个区段，区段的大小和已经分配的大小相同(每次翻倍)
+ * FILE_EXTENT_MIN: 区段大小的下限(字节)，小表最多多占用这么多空间
+ * FILE_EXTENT_MAX: 区段大小的上限(字节)。启动时设置了环境变量DBMS_EXTENT_MB(单位MB)时由它决定，为0时不预先分配
+ */
+#define FILE_EXTENT_MIN (1 << 20)
+#define FILE_EXTENT_MAX (64 << 20)
+/*
+ * 页面校验和，见PageChecksums
+ * PAGE_CRC_SUFFIX: 数据文件的校验和存放在文件名加上这个后缀的文件中
+ * FILE_PAGE_CORRUPT: 读出的页面和记录的校验和不同时，FileManager::readPage的返回值和PageRun::result
+ */
+#define PAGE_CRC_SUFFIX ".crc"
+#define FILE_PAGE_CORRUPT (-2)
+/*
+ * 缓存中页面个数的默认值
+ * 启动时如果设置了环境变量DBMS_BUFFER_MB(单位MB)，缓存页面个数由它决定，见BufPageManager::Instance
+ */
+#define CAP 60000
+/*
+ * 缓存页面集中在一块按BUF_ARENA_ALIGN对齐的内存中，对齐大小同时也是大页的大小
+ * BUF_USE_HUGETLB: 为1时先用MAP_HUGETLB申请大页，失败(比如系统没有预留大页)时退回普通页面并建议内核使用透明大页
+ * BUF_MIN_SHARD_FRAMES: 每个分片至少有这么多个页面
+ */
+#define BUF_ARENA_ALIGN (2 << 20)
+#define BUF_USE_HUGETLB 1
+#define BUF_MIN_SHARD_FRAMES 64
+/*
+ * 缓存替换算法
+ * REPLACE_LRU: 栈式LRU, 见FindReplace
+ * REPLACE_2Q: 2Q, 全表扫描不会冲刷热页面, 见TwoQReplace
+ */
+#define REPLACE_LRU 0
+#define REPLACE_2Q 1
+#define BUF_REPLACE_POLICY REPLACE_2Q
+/*
+ * 缓存分片数，每个分片有独立的锁、hash表和替换算法
+ * 缓存页面个数会被向下取整为它的倍数
+ */
+#define BUF_SHARD_NUM 16
+/*
+ * 后台写回线程的参数，见BufPageManager::startFlusher
+ * BUF_MAX_DIRTY_PERCENT: 一个分片中脏页的比例上限(百分比)，超过时立即开始写回
+ * BUF_FLUSH_INTERVAL: 两轮写回之间的间隔(毫秒)
+ * BUF_FLUSH_BATCH: 每轮在一个分片中最多写回的页面数
+ * BUF_CLEAN_TARGET: 每个分片中接下来最先被替换的这么多个页面会被保持为干净的
+ * BUF_WRITEV_MAX: 批量写回时一次pwritev最多写的连续页面数
+ */
+#define BUF_MAX_DIRTY_PERCENT 25
+#define BUF_FLUSH_INTERVAL 100
+#define BUF_FLUSH_BATCH 256
+#define BUF_CLEAN_TARGET 64
+#define BUF_WRITEV_MAX 64
+/*
+ * 顺序预读，见BufPageManager::startPrefetcher
+ * BUF_READ_AHEAD: 发现顺序访问后，预读之后的页面数，为0时不预读
+ * BUF_READ_AHEAD_TRIGGER: 连续访问多少个相邻页面后认为是顺序访问
+ * BUF_PREFETCH_QUEUE: 预读请求队列的长度上限，队列满时丢弃新的请求
+ * BUF_PREFETCH_BATCH: 预读线程一次取出并同时读入的请求数
+ */
+#define BUF_READ_AHEAD 16
+#define BUF_READ_AHEAD_TRIGGER 2
+#define BUF_PREFETCH_QUEUE 256
+#define BUF_PREFETCH_BATCH 16
+/*
+ * 批量操作的环形缓冲区，见BufPageManager::startBulk
+ * BUF_RING_SIZE: 环形缓冲区的大小(字节)，平均分到每个分片
+ * BUF_RING_MIN_SHARD_FRAMES: 每个分片至少有这么多个页面，要能容纳当前页面和已经预读进来的页面
+ */
+#define BUF_RING_SIZE (256 << 10)
+#define BUF_RING_MIN_SHARD_FRAMES 4
+/*
+ * 只读映射的文件(见FileManager::openFile)中的页面不进入缓存，getPage等函数直接返回映射中的地址
+ * 这样的页面用下标BUF_MAPPED_INDEX表示，对它的pin、unpin、access、writeBack等操作什么也不做
+ */
+#define BUF_MAPPED_INDEX (-2)
+/*
+ * 预写日志，见LogManager和BufPageManager::beginGroup
+ * LOG_RESERVED_NAME: 每个数据库目录下的日志文件名
+ * LOG_BUFFER_SIZE: 日志缓冲区的大小(字节)，写满时顺序写入日志文件
+ * LOG_HEADER_SIZE: 日志文件头的大小(字节)
+ * LOG_DIFF_GAP: 一个页面中相距不超过这么多字节的两段修改合并为一条日志记录
+ * LOG_CHECKPOINT_SIZE: 上次检查点之后日志增长超过这个大小(字节)时，后台线程开始一次检查点，见BufPageManager::flushRound
+ * LOG_CHECKPOINT_INTERVAL: 上次检查点之后有新的日志，并且超过这么长时间(毫秒)时也开始一次检查点
+ * LOG_SEGMENT_SIZE: 检查点之后按这个大小(字节)释放不再需要的日志空间
+ * LOG_COMMIT_DELAY: 组提交的延迟(微秒)，有多个线程同时提交时先等待这么久再同步，见LogManager::Commit
+ *           启动时设置了环境变量DBMS_COMMIT_DELAY时由它决定
+ */
+#define LOG_RESERVED_NAME "WAL"
+#define LOG_BUFFER_SIZE (1 << 20)
+#define LOG_HEADER_SIZE 64
+#define LOG_DIFF_GAP 32
+#define LOG_CHECKPOINT_SIZE (64 << 20)
+#define LOG_CHECKPOINT_INTERVAL 30000
+#define LOG_SEGMENT_SIZE (4 << 20)
+#define LOG_COMMIT_DELAY 0
+#define IN_DEBUG 0
+#define DEBUG_DELETE 0
+#define DEBUG_ERASE 1
+#define DEBUG_NEXT 1
+/**
+ * 记录页的起始下标,在这之前都是位图页
+*/
+#define START_PAGE 15
+/**
+ * 一个表中列的上限
+ */
+#define MAX_COL_NUM 31
+/**
+ * 表示对应的column为null
+*/
+#define COL_ID_NONE 31
+/**
+ * 数据库中表的个数上限
+ * 为什么是31而非32: 为null留一个编码,表示非0-30号表中的任一个
+ */
+#define MAX_TB_NUM 31
+/**
+ * 表示对应的table为null
+*/
+#define TB_ID_NONE 31
+
+//below macros are added by msh
+/**
+ * Max string length for an attribute
+*/
+#define MAX_ATTRI_NAME_LEN 32
+/**
+ * Max string length for a database name
+*/
+#define MAX_DB_NAME_LEN 32
+/**
+ * Max string length for a table name
+*/
+#define MAX_TABLE_NAME_LEN 32
+/**
+ * Max string length for a constraint
+*/
+#define MAX_CONSTRAINT_NAME_LEN 16
+/**
+ * Max times a table can be referrenced as a foreign key source
+*/
+#define MAX_FK_MASTER_TIME 30
+/**
+ * Max number of foreign key constraints a table can have
+*/
+#define MAX_REF_SLAVE_TIME 16
+/**
+ * Length of fragments to break varchar into, total length = 502 + 10 = 512 B
+*/
+#define VARCHAR_RECORD_LEN 512
+/**
+ * Max number of indexes a table can have
+*/
+#define MAX_INDEX_NUM 16
+/**
+ * Indicates an invalid index id
+*/
+#define INDEX_ID_NONE 16
+/**
+ * Max string length for a index
+*/
+#define MAX_INDEX_NAME_LEN 16
+
+#define VARCHAR_FRAG_LEN (VARCHAR_RECORD_LEN - 10)
+
+#define DBMS_RESERVED_TABLE_NAME "ALL_DB"
+#define DB_RESERVED_TABLE_NAME "ALL_TB"
+#define IDX_RESERVED_TABLE_NAME "BPTREE"
+#define VARCHAR_RESERVED_TABLE_NAME "VARCHAR"
+#define TMP_RESERVED_TABLE_NAME "TMP"
+#define PRIMARY_RESERVED_IDX_NAME "PRMIARY_INDEX"
+
+#define DEBUG // If this macro is set, debug methods are available
+
+#define RELEASE 1
+typedef unsigned int* BufType;
+typedef unsigned int uint;
+typedef unsigned short ushort;
+// use uchar instead of char when manipulating bytes for efficiency and safety pls
+// use char only when dealing with strings
+typedef unsigned char uchar; 
+typedef unsigned long long ull;
+typedef long long ll;
+typedef double db;
+typedef int INT;
+typedef int(cf)(uchar*, uchar*);
+// what the hell are these ?
+// int current = 0;
+// int tt = 0;
+#endif